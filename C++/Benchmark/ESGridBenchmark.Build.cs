@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using System.IO;
+using UnrealBuildTool;
+
+public class ESGridBenchmark : ModuleRules
+{
+	public ESGridBenchmark(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicIncludePaths.Add("Runtime/Launch/Public");
+		PrivateIncludePaths.Add("Runtime/Launch/Private");
+
+		// Source root of the game module, the grid sources are included as "Core/Grid/..."
+		PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "..", "..", "EveOfTheStorm"));
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "Core", "Projects" });
+
+		// The grid sources are compiled into this program instead of linked from the game module
+		PrivateDefinitions.Add("EVEOFTHESTORM_API=");
+		// Timings of the grid itself, the game stat scopes would only add noise
+		PrivateDefinitions.Add("ES_GRID_STATS=0");
+	}
+}
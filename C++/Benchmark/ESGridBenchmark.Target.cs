@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+// Console program timing FESGridCore on its own, only the Core module is linked
+[SupportedPlatforms(UnrealPlatformClass.Desktop)]
+public class ESGridBenchmarkTarget : TargetRules
+{
+	public ESGridBenchmarkTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Program;
+		LinkType = TargetLinkType.Monolithic;
+		LaunchModuleName = "ESGridBenchmark";
+		SolutionDirectory = "Programs";
+
+		bCompileAgainstEngine = false;
+		bCompileAgainstCoreUObject = false;
+		bCompileAgainstApplicationCore = false;
+		bCompileICU = false;
+		bBuildDeveloperTools = false;
+		bUseLoggingInShipping = true;
+		bIsBuildingConsoleApplication = true;
+	}
+}
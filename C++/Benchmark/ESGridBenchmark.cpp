@@ -0,0 +1,333 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridBenchmark.cpp#
+ * Author: Yuyang Qiu
+ * Function:Standalone timings of FESGridCore shape queries, bulk writes, scans and removals on 256 to 4096 grids.
+ */
+
+#include "RequiredProgramMainCPPInclude.h"
+#include "Misc/CommandLine.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Core/Grid/ESGridCore.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogESGridBenchmark, Log, All);
+
+IMPLEMENT_APPLICATION(ESGridBenchmark, "ESGridBenchmark");
+
+/**
+ * Timing loop of one benchmark run, iterations repeat until MinSeconds of timed work:
+ * while (State.KeepRunning()) { ... }
+ */
+class FBenchmarkState
+{
+public:
+	explicit FBenchmarkState(double InMinSeconds) : MinSeconds(InMinSeconds) {}
+
+	bool KeepRunning()
+	{
+		if (bStarted)
+		{
+			PauseTiming();
+			++Iterations;
+		}
+		bStarted = true;
+
+		if (Iterations >= MaxIterations || (Iterations > 0 && Elapsed >= MinSeconds))
+		{
+			return false;
+		}
+		ResumeTiming();
+		return true;
+	}
+
+	// Exclude setup inside an iteration, every pause needs its resume before the next KeepRunning
+	void PauseTiming()
+	{
+		if (bTiming)
+		{
+			Elapsed += FPlatformTime::Seconds() - StartTime;
+			bTiming = false;
+		}
+	}
+
+	void ResumeTiming()
+	{
+		bTiming = true;
+		StartTime = FPlatformTime::Seconds();
+	}
+
+	void AddItems(int64 Num) { Items += Num; }
+
+	int64 GetIterations() const { return Iterations; }
+
+	int64 GetItems() const { return Items; }
+
+	double GetElapsed() const { return Elapsed; }
+
+private:
+	static constexpr int64 MaxIterations = 1 << 20;
+
+	double MinSeconds = 0.0;
+
+	double Elapsed = 0.0;
+
+	double StartTime = 0.0;
+
+	int64 Iterations = 0;
+
+	int64 Items = 0;
+
+	bool bStarted = false;
+
+	bool bTiming = false;
+};
+
+/**
+ * Shared input of every benchmark at one grid size: a centred island over a quarter of the grid,
+ * three quarters of its cells holding random ground.
+ */
+struct FBenchmarkContext
+{
+	int32 Size = 0;
+
+	EESGridStorageLayout Layout = EESGridStorageLayout::RowMajor;
+
+	FIntRect Island;
+
+	TArray<EGroundType> IslandCells;
+
+	// Anchors and directions of the shape queries
+	TArray<FIntPoint> Anchors;
+
+	TArray<EGridDirection> Directions;
+};
+
+static const TArray<FIntPoint> SquareShape = {FIntPoint(0, 0), FIntPoint(1, 0), FIntPoint(0, 1), FIntPoint(1, 1)};
+
+static const TArray<FIntPoint> LShape = {FIntPoint(0, 0), FIntPoint(0, 1), FIntPoint(0, 2), FIntPoint(1, 2)};
+
+static constexpr int32 QueryCount = 4096;
+
+// Results are folded in here so the optimizer keeps the measured calls
+static volatile int64 Sink = 0;
+
+static void MakeContext(int32 Size, EESGridStorageLayout Layout, FBenchmarkContext& OutContext)
+{
+	FRandomStream Stream(Size);
+	OutContext.Size = Size;
+	OutContext.Layout = Layout;
+	OutContext.Island = FIntRect(Size / 4, Size / 4, Size - Size / 4, Size - Size / 4);
+
+	const FIntPoint IslandSize = OutContext.Island.Size();
+	OutContext.IslandCells.SetNumUninitialized(IslandSize.X * IslandSize.Y);
+	for (EGroundType& Cell : OutContext.IslandCells)
+	{
+		Cell = Stream.FRand() < 0.75f ? static_cast<EGroundType>(Stream.RandRange(1, GroundTypeCount - 1)) : GroundTypeNone;
+	}
+
+	OutContext.Anchors.SetNumUninitialized(QueryCount);
+	OutContext.Directions.SetNumUninitialized(QueryCount);
+	for (int32 i = 0; i < QueryCount; i++)
+	{
+		OutContext.Anchors[i] = FIntPoint(Stream.RandRange(0, Size - 1), Stream.RandRange(0, Size - 1));
+		OutContext.Directions[i] = static_cast<EGridDirection>(Stream.RandRange(0, GridDirectionCount - 1));
+	}
+}
+
+static void BuildIsland(FESGridCore& Core, const FBenchmarkContext& Context)
+{
+	Core.Initialize(Context.Size, Context.Size, Context.Layout);
+	Core.BuildFromCells(Context.Island, Context.IslandCells.GetData());
+}
+
+static void BM_HasShape(FBenchmarkState& State, const FBenchmarkContext& Context)
+{
+	FESGridCore Core;
+	BuildIsland(Core, Context);
+	const FESGridShapeHandle Shape = Core.RegisterShape(LShape);
+
+	int64 Hits = 0;
+	while (State.KeepRunning())
+	{
+		for (int32 i = 0; i < QueryCount; i++)
+		{
+			Hits += Core.HasShape(Context.Anchors[i].X, Context.Anchors[i].Y, Shape, Context.Directions[i]);
+		}
+		State.AddItems(QueryCount);
+	}
+	Sink += Hits;
+}
+
+static void BM_CanPlaceShape(FBenchmarkState& State, const FBenchmarkContext& Context)
+{
+	FESGridCore Core;
+	BuildIsland(Core, Context);
+	const FESGridShapeHandle Shape = Core.RegisterShape(LShape);
+
+	int64 Hits = 0;
+	while (State.KeepRunning())
+	{
+		for (int32 i = 0; i < QueryCount; i++)
+		{
+			Hits += Core.CanPlaceShape(Context.Anchors[i].X, Context.Anchors[i].Y, Shape, Context.Directions[i]);
+		}
+		State.AddItems(QueryCount);
+	}
+	Sink += Hits;
+}
+
+// Tile the island area with squares in one transaction, starting from an empty grid
+static void BM_SetShape(FBenchmarkState& State, const FBenchmarkContext& Context)
+{
+	FESGridCore Core;
+	const FESGridShapeHandle Shape = Core.RegisterShape(SquareShape);
+	const FGridShapeRotation& Square = Core.GetShapeLibrary().Get(Shape).GetRotation(GridDirectionNorth);
+	const FIntRect& Island = Context.Island;
+
+	while (State.KeepRunning())
+	{
+		State.PauseTiming();
+		Core.Initialize(Context.Size, Context.Size, Context.Layout);
+		State.ResumeTiming();
+
+		Core.BeginEdit();
+		for (int32 y = Island.Min.Y; y < Island.Max.Y; y += 2)
+		{
+			for (int32 x = Island.Min.X; x < Island.Max.X; x += 2)
+			{
+				Core.SetShape(x, y, Square, static_cast<EGroundType>(1 + ((x ^ y) >> 1) % (GroundTypeCount - 1)));
+			}
+		}
+		FGridEditBatch Batch;
+		Core.CommitEdit(Batch);
+		State.AddItems(Batch.Changes.Num());
+	}
+}
+
+static void BM_GetPoints(FBenchmarkState& State, const FBenchmarkContext& Context)
+{
+	FESGridCore Core;
+	BuildIsland(Core, Context);
+
+	int64 Points = 0;
+	while (State.KeepRunning())
+	{
+		const int32 Num = Core.GetPointsOfType(GroundTypeNone).Num();
+		Points += Num;
+		State.AddItems(Num);
+	}
+	Sink += Points;
+}
+
+// Clear the island square by square in one transaction, the island is rebuilt untimed each iteration
+static void BM_RemoveShape(FBenchmarkState& State, const FBenchmarkContext& Context)
+{
+	FESGridCore Core;
+	const FESGridShapeHandle Shape = Core.RegisterShape(SquareShape);
+	const FIntRect& Island = Context.Island;
+
+	while (State.KeepRunning())
+	{
+		State.PauseTiming();
+		BuildIsland(Core, Context);
+		State.ResumeTiming();
+
+		Core.BeginEdit();
+		for (int32 y = Island.Min.Y; y < Island.Max.Y; y += 2)
+		{
+			for (int32 x = Island.Min.X; x < Island.Max.X; x += 2)
+			{
+				Core.RemoveShape(x, y, Shape, GridDirectionNorth);
+			}
+		}
+		FGridEditBatch Batch;
+		Core.CommitEdit(Batch);
+		State.AddItems(Batch.Changes.Num());
+	}
+}
+
+struct FBenchmark
+{
+	const TCHAR* Name;
+
+	void (*Run)(FBenchmarkState& State, const FBenchmarkContext& Context);
+};
+
+static const FBenchmark Benchmarks[] =
+{
+	{TEXT("HasShape"), &BM_HasShape},
+	{TEXT("CanPlaceShape"), &BM_CanPlaceShape},
+	{TEXT("SetShape"), &BM_SetShape},
+	{TEXT("GetPoints"), &BM_GetPoints},
+	{TEXT("RemoveShape"), &BM_RemoveShape},
+};
+
+static const int32 GridSizes[] = {256, 1024, 4096};
+
+/**
+ * ESGridBenchmark [-filter=Name] [-layout=RowMajor|Tiled|Chunked] [-mintime=Seconds] [-csv=Path]
+ * Runs every benchmark whose name contains the filter at each grid size.
+ */
+INT32_MAIN_INT32_ARGC_TCHAR_ARGV()
+{
+	GEngineLoop.PreInit(ArgC, ArgV);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FString Filter;
+	FParse::Value(CommandLine, TEXT("filter="), Filter);
+	FString LayoutName;
+	FParse::Value(CommandLine, TEXT("layout="), LayoutName);
+	double MinSeconds = 0.5;
+	FParse::Value(CommandLine, TEXT("mintime="), MinSeconds);
+	FString CsvPath;
+	FParse::Value(CommandLine, TEXT("csv="), CsvPath);
+
+	EESGridStorageLayout Layout = EESGridStorageLayout::RowMajor;
+	if (LayoutName.Equals(TEXT("Tiled"), ESearchCase::IgnoreCase))
+	{
+		Layout = EESGridStorageLayout::Tiled;
+	}
+	else if (LayoutName.Equals(TEXT("Chunked"), ESearchCase::IgnoreCase))
+	{
+		Layout = EESGridStorageLayout::Chunked;
+	}
+
+	FString Csv = TEXT("Name,Size,Iterations,NsPerIteration,ItemsPerSecond\n");
+	for (const int32 Size : GridSizes)
+	{
+		FBenchmarkContext Context;
+		MakeContext(Size, Layout, Context);
+
+		for (const FBenchmark& Benchmark : Benchmarks)
+		{
+			if (!Filter.IsEmpty() && !FCString::Stristr(Benchmark.Name, *Filter))
+			{
+				continue;
+			}
+
+			FBenchmarkState State(MinSeconds);
+			Benchmark.Run(State, Context);
+
+			const double NsPerIteration = State.GetElapsed() * 1e9 / FMath::Max<int64>(State.GetIterations(), 1);
+			const double ItemsPerSecond = State.GetItems() / FMath::Max(State.GetElapsed(), 1e-9);
+			UE_LOG(LogESGridBenchmark, Display, TEXT("%-16s %5d %8lld iters %14.0f ns/iter %10.2f Mitems/s"),
+			       Benchmark.Name, Size, State.GetIterations(), NsPerIteration, ItemsPerSecond / 1e6);
+			Csv += FString::Printf(TEXT("%s,%d,%lld,%.0f,%.0f\n"), Benchmark.Name, Size, State.GetIterations(),
+			                       NsPerIteration, ItemsPerSecond);
+		}
+	}
+
+	if (!CsvPath.IsEmpty())
+	{
+		FFileHelper::SaveStringToFile(Csv, *CsvPath);
+	}
+
+	FCoreDelegates::OnExit.Broadcast();
+	FEngineLoop::AppPreExit();
+	FModuleManager::Get().UnloadModulesAtShutdown();
+	FEngineLoop::AppExit();
+	return 0;
+}
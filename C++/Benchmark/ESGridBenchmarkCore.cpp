@@ -0,0 +1,16 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridBenchmarkCore.cpp#
+ * Author: Yuyang Qiu
+ * Function:Compiles the engine-independent grid core into the benchmark program.
+ */
+
+// Only Core module code is pulled in here, nothing from the UESGridSystem layer
+#include "Core/Grid/ESGridStorage.cpp"
+#include "Core/Grid/ESGridShapeLibrary.cpp"
+#include "Core/Grid/ESGridBitboard.cpp"
+#include "Core/Grid/ESGridSnapshot.cpp"
+#include "Core/Grid/ESGridAreaCounts.cpp"
+#include "Core/Grid/ESGridCore.cpp"
+#include "Core/Grid/ESGridCoreSerialization.cpp"
@@ -8,9 +8,10 @@
 
 #include "Core/Grid/ESGridActor.h"
 
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
 #include "Components/InstancedStaticMeshComponent.h"
 #include "Core/Game/ESDefaultGameMode.h"
-#include "Core/Grid/ESGridHelper.h"
+#include "Core/Grid/ESGridStats.h"
 #include "Core/Grid/ESGridSystem.h"
 
 
@@ -59,104 +60,404 @@ void AESGridActor::BeginPlay()
 	if (GameMode)
 	{
 		GridSystem = GameMode->GridSystem;
-		GridSystem->OnTilePlaced().AddUObject(this, &AESGridActor::OnTilePlaced);
-		GridSystem->OnTileRemoved().AddUObject(this, &AESGridActor::OnTileRemoved);
-		GridSystem->OnTileChanged().AddUObject(this, &AESGridActor::OnTileUpdate);
+		GridSystem->OnTilesChanged().AddUObject(this, &AESGridActor::OnTilesChanged);
+		GridSystem->OnGridLoaded().AddUObject(this, &AESGridActor::RebuildTiles);
 	}
 
+	ApplyGridLayout();
+
+	PreviewMaterial = UMaterialInstanceDynamic::Create(TilePreviewMesh->GetMaterial(0), this);
+	TilePreviewMesh->SetMaterial(0, PreviewMaterial);
+}
+
+void AESGridActor::ApplyGridLayout()
+{
 	GroundPlane->SetBoxExtent(FVector(GridSize * GridSystem->GridSizeX / 2, GridSize * GridSystem->GridSizeY / 2, 1));
 	GridScene->SetRelativeLocation(FVector(-(GridSize * GridSystem->GridSizeX / 2), -(GridSize * GridSystem->GridSizeY / 2), 1));
 	// GridMeshes->SetRelativeLocation(FVector(-(GridSize * GridSystem->GridSizeX / 2), -(GridSize * GridSystem->GridSizeY / 2), 1));
 	TilePreviewMesh->SetRelativeLocation(FVector(-(GridSize * GridSystem->GridSizeX / 2), -(GridSize * GridSystem->GridSizeY / 2), 1));
+}
 
-	PreviewMaterial = UMaterialInstanceDynamic::Create(TilePreviewMesh->GetMaterial(0), this);
-	TilePreviewMesh->SetMaterial(0, PreviewMaterial);
+void AESGridActor::OnTilesChanged(const FGridEditBatch& Batch)
+{
+	for (const FGridCellChange& Change : Batch.Changes)
+	{
+		const FIntPoint Cell(Change.X, Change.Y);
+		if (FGridRenderOp* Op = PendingRenderOps.Find(Cell))
+		{
+			Op->TargetType = Change.NewType;
+			// Edits that undo each other before the queue reaches them never touch the meshes
+			if (Op->TargetType == Op->RenderedType)
+			{
+				PendingRenderOps.Remove(Cell);
+			}
+			continue;
+		}
 
-	// Initial Ground Meshes
-	for (int i = 1; i < 6; ++i)
-	{
-		EGroundType Type = static_cast<EGroundType>(i);
-		MeshIndex.Emplace(Type, TArray<FIntPoint>());
-		UInstancedStaticMeshComponent* MeshInstance = NewObject<UInstancedStaticMeshComponent>(this, *FString("Grid Mesh" + FString::FromInt(i)));
-		MeshInstance->SetupAttachment(GridScene);
-		MeshInstance->RegisterComponent();
-		// MeshInstance->AttachToComponent(GridScene, FAttachmentTransformRules::KeepRelativeTransform);
-		MeshInstance->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
-		MeshInstance->SetCollisionResponseToAllChannels(ECR_Ignore);
-		MeshInstance->SetCollisionResponseToChannel(ECC_WorldStatic, ECR_Block);
-		MeshInstance->SetCollisionResponseToChannel(ECC_GameTraceChannel2, ECR_Block);
-		MeshInstance->SetStaticMesh(TileMesh);
-		switch (i)
-		{
-		case 1:
-			MeshInstance->ComponentTags.Add(FName("Rock"));
-			break;
-		case 2:
-			MeshInstance->ComponentTags.Add(FName("Sand"));
-			break;
-		case 3:
-			MeshInstance->ComponentTags.Add(FName("Grass"));
-			break;
+		FGridRenderOp& Op = PendingRenderOps.Add(Cell);
+		Op.RenderedType = Change.OldType;
+		Op.TargetType = Change.NewType;
+		PendingRenderOrder.Add(Cell);
+	}
+
+	if (!bDeferRenderUpdates)
+	{
+		FlushRenderUpdates();
+	}
+}
+
+void AESGridActor::RebuildTiles()
+{
+	// Meshes are kept for the chunks that still have tiles, the others are released below
+	for (const auto& Pair : GridMeshes)
+	{
+		Pair.Value->ClearInstances();
+	}
+	MeshIndex.Reset();
+	PendingRenderOps.Reset();
+	PendingRenderOrder.Reset();
+	PendingRenderHead = 0;
+	PreviewEditVersion = INDEX_NONE;
+	// A load may have changed the grid size
+	ApplyGridLayout();
+
+	const FESGridStorage& Storage = GridSystem->GetStorage();
+	TMap<FBlockIndex, TArray<FIntPoint>> Added;
+	for (int32 i = 1; i < GroundTypeCount; ++i)
+	{
+		FBlockIndex Block;
+		Block.Type = static_cast<EGroundType>(i);
+		for (const int32 Index : GridSystem->GetOccupiedCells(Block.Type))
+		{
+			const FIntPoint Cell = Storage.ToPoint(Index);
+			Block.Point = GetRenderChunk(Cell.X, Cell.Y);
+			Added.FindOrAdd(Block).Add(Cell);
+		}
+	}
+	for (const auto& Pair : Added)
+	{
+		AddTileInstances(Pair.Key, Pair.Value);
+	}
+
+	TArray<FBlockIndex> Empty;
+	for (const auto& Pair : GridMeshes)
+	{
+		if (!Added.Contains(Pair.Key))
+		{
+			Empty.Add(Pair.Key);
+		}
+	}
+	for (const FBlockIndex& Block : Empty)
+	{
+		ReleaseChunkMesh(Block);
+	}
+}
+
+int32 AESGridActor::GetPendingRenderUpdates() const
+{
+	return PendingRenderOps.Num();
+}
+
+void AESGridActor::FlushRenderUpdates()
+{
+	ProcessRenderOps(MAX_int32, 0);
+}
+
+void AESGridActor::ProcessRenderOps(int32 MaxOps, double MaxSeconds)
+{
+	// Cells are applied in slices so the time budget is checked between mesh rebuilds
+	constexpr int32 SliceSize = 256;
+	const double StartTime = FPlatformTime::Seconds();
+	int32 OpsLeft = MaxOps;
+
+	while (PendingRenderHead < PendingRenderOrder.Num() && OpsLeft > 0)
+	{
+		// Group by chunk and type so each mesh is rebuilt once, removals first so updated cells are re-added
+		TMap<FBlockIndex, TArray<FIntPoint>> Removed;
+		TMap<FBlockIndex, TArray<FIntPoint>> Added;
+		const int32 SliceEnd = FMath::Min(PendingRenderOrder.Num(), PendingRenderHead + FMath::Min(OpsLeft, SliceSize));
+		for (; PendingRenderHead < SliceEnd; ++PendingRenderHead)
+		{
+			const FIntPoint Cell = PendingRenderOrder[PendingRenderHead];
+			FGridRenderOp Op;
+			if (!PendingRenderOps.RemoveAndCopyValue(Cell, Op))
+			{
+				continue;
+			}
+			--OpsLeft;
+
+			FBlockIndex Block;
+			Block.Point = GetRenderChunk(Cell.X, Cell.Y);
+			if (Op.RenderedType != EGroundType::None)
+			{
+				Block.Type = Op.RenderedType;
+				Removed.FindOrAdd(Block).Add(Cell);
+			}
+			if (Op.TargetType != EGroundType::None)
+			{
+				Block.Type = Op.TargetType;
+				Added.FindOrAdd(Block).Add(Cell);
+			}
+		}
+
+		for (const auto& Pair : Removed)
+		{
+			RemoveTileInstances(Pair.Key, Pair.Value);
+		}
+		for (const auto& Pair : Added)
+		{
+			AddTileInstances(Pair.Key, Pair.Value);
 		}
 
-		if (GroundMaterials.Contains(Type))
+		// Checked after the additions, a chunk emptied and refilled in one slice keeps its mesh
+		for (const auto& Pair : Removed)
 		{
-			for (int j = 0; j < GroundMaterials[Type].Materials.Num(); ++j)
+			const FGridInstanceSet* Set = MeshIndex.Find(Pair.Key);
+			if (!Set || Set->Cells.Num() == 0)
 			{
-				MeshInstance->SetMaterial(j, GroundMaterials[Type].Materials[j]);
+				ReleaseChunkMesh(Pair.Key);
 			}
 		}
-		GridMeshes.Add(Type, MeshInstance);
+
+		if (MaxSeconds > 0 && FPlatformTime::Seconds() - StartTime >= MaxSeconds)
+		{
+			break;
+		}
+	}
+
+	// Drop the consumed part of the queue once it dominates
+	if (PendingRenderHead >= PendingRenderOrder.Num())
+	{
+		PendingRenderOrder.Reset();
+		PendingRenderHead = 0;
+	}
+	else if (PendingRenderHead > PendingRenderOrder.Num() / 2)
+	{
+		PendingRenderOrder.RemoveAt(0, PendingRenderHead, false);
+		PendingRenderHead = 0;
 	}
 }
 
-void AESGridActor::OnTilePlaced(int X, int Y, EGroundType Type)
+void AESGridActor::AddTileInstances(const FBlockIndex& Block, const TArray<FIntPoint>& Cells)
 {
-	const FTransform Transform = GetTileTransform(X, Y);
-	const int32 i = GridMeshes[Type]->AddInstance(Transform);
-	if (i != MeshIndex[Type].Add(FIntPoint(X, Y)))
+	ES_GRID_SCOPE(AddInstances);
+
+	UHierarchicalInstancedStaticMeshComponent* Mesh = FindOrCreateChunkMesh(Block);
+	FGridInstanceSet& Set = MeshIndex.FindOrAdd(Block);
+
+	TArray<FTransform> Transforms;
+	Transforms.Reserve(Cells.Num());
+	for (const FIntPoint& Cell : Cells)
+	{
+		Transforms.Add(GetTileTransform(Cell.X, Cell.Y));
+	}
+
+	const TArray<int32> Indices = Mesh->AddInstances(Transforms, true);
+	for (int32 i = 0; i < Cells.Num(); ++i)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Adding wrong"))
+		const int32 Index = Set.Cells.Add(Cells[i]);
+		if (!Indices.IsValidIndex(i) || Indices[i] != Index)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Adding wrong"))
+		}
+		Set.Instances.Add(Cells[i], Index);
+		OnTileSpawned(Block.Type, Index);
+		OnTileInstanceSpawned(Block.Type, Mesh, Index, Cells[i]);
 	}
-	OnTileSpawned(Type, i);
 }
 
-void AESGridActor::OnTileRemoved(int X, int Y, EGroundType Type)
+void AESGridActor::RemoveTileInstances(const FBlockIndex& Block, const TArray<FIntPoint>& Cells)
 {
-	FIntPoint Point = FIntPoint(X, Y);
-	for (int i = 0; i < MeshIndex[Type].Num(); ++i)
+	ES_GRID_SCOPE(RemoveInstances);
+
+	FGridInstanceSet* Set = MeshIndex.Find(Block);
+	UHierarchicalInstancedStaticMeshComponent** Mesh = GridMeshes.Find(Block);
+	if (!Set || !Mesh)
+	{
+		return;
+	}
+	const int32 OldNum = Set->Cells.Num();
+
+	for (const FIntPoint& Cell : Cells)
 	{
-		if (Point == MeshIndex[Type][i])
+		int32 Index;
+		if (!Set->Instances.RemoveAndCopyValue(Cell, Index))
 		{
-			MeshIndex[Type].RemoveAt(i);
-			GridMeshes[Type]->RemoveInstance(i);
-			break;
+			continue;
+		}
+
+		// Move the last live instance into the hole, the tail is trimmed below
+		const int32 Last = Set->Cells.Num() - 1;
+		if (Index != Last)
+		{
+			FTransform LastTransform;
+			(*Mesh)->GetInstanceTransform(Last, LastTransform);
+			(*Mesh)->UpdateInstanceTransform(Index, LastTransform, false, false, true);
+			Set->Cells[Index] = Set->Cells[Last];
+			Set->Instances[Set->Cells[Index]] = Index;
+		}
+		Set->Cells.Pop(false);
+		OnTileDestroyed(Block.Type, Cell.X, Cell.Y);
+	}
+
+	// Removing from the end never shifts the remaining instances
+	if (Set->Cells.Num() < OldNum)
+	{
+		TArray<int32> Tail;
+		Tail.Reserve(OldNum - Set->Cells.Num());
+		for (int32 i = OldNum - 1; i >= Set->Cells.Num(); --i)
+		{
+			Tail.Add(i);
+		}
+		(*Mesh)->RemoveInstances(Tail);
+		(*Mesh)->MarkRenderStateDirty();
+	}
+}
+
+FIntPoint AESGridActor::GetRenderChunk(int X, int Y) const
+{
+	// Floor division, unbounded grids have negative cells
+	const int32 Size = FMath::Max(RenderChunkSize, 1);
+	return FIntPoint(X >= 0 ? X / Size : (X - Size + 1) / Size,
+	                 Y >= 0 ? Y / Size : (Y - Size + 1) / Size);
+}
+
+UHierarchicalInstancedStaticMeshComponent* AESGridActor::FindOrCreateChunkMesh(const FBlockIndex& Block)
+{
+	if (UHierarchicalInstancedStaticMeshComponent** Existing = GridMeshes.Find(Block))
+	{
+		return *Existing;
+	}
+
+	const FString Name = FString::Printf(TEXT("Grid Mesh%d %d_%d"), static_cast<int32>(Block.Type), Block.Point.X, Block.Point.Y);
+	UHierarchicalInstancedStaticMeshComponent* MeshInstance = NewObject<UHierarchicalInstancedStaticMeshComponent>(this, *Name);
+	MeshInstance->SetupAttachment(GridScene);
+	MeshInstance->RegisterComponent();
+	MeshInstance->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	MeshInstance->SetCollisionResponseToAllChannels(ECR_Ignore);
+	MeshInstance->SetCollisionResponseToChannel(ECC_WorldStatic, ECR_Block);
+	MeshInstance->SetCollisionResponseToChannel(ECC_GameTraceChannel2, ECR_Block);
+	MeshInstance->SetStaticMesh(TileMesh);
+	if (ChunkCullDistanceEnd > 0)
+	{
+		MeshInstance->SetCullDistances(ChunkCullDistanceStart, ChunkCullDistanceEnd);
+	}
+	switch (static_cast<int32>(Block.Type))
+	{
+	case 1:
+		MeshInstance->ComponentTags.Add(FName("Rock"));
+		break;
+	case 2:
+		MeshInstance->ComponentTags.Add(FName("Sand"));
+		break;
+	case 3:
+		MeshInstance->ComponentTags.Add(FName("Grass"));
+		break;
+	}
+
+	if (GroundMaterials.Contains(Block.Type))
+	{
+		for (int j = 0; j < GroundMaterials[Block.Type].Materials.Num(); ++j)
+		{
+			MeshInstance->SetMaterial(j, GroundMaterials[Block.Type].Materials[j]);
 		}
 	}
-	OnTileDestroyed(Type, X, Y);
+	GridMeshes.Add(Block, MeshInstance);
+	return MeshInstance;
 }
 
-void AESGridActor::OnTileUpdate(int X, int Y, EGroundType OldType, EGroundType NewType)
+void AESGridActor::ReleaseChunkMesh(const FBlockIndex& Block)
 {
-	OnTileRemoved(X, Y, OldType);
-	OnTilePlaced(X, Y, NewType);
+	UHierarchicalInstancedStaticMeshComponent* Mesh;
+	if (GridMeshes.RemoveAndCopyValue(Block, Mesh))
+	{
+		Mesh->DestroyComponent();
+	}
+	MeshIndex.Remove(Block);
 }
 
-void AESGridActor::SetPreviewMesh(const FGridTile Tile, EGridDirection Direction)
+bool AESGridActor::FindTileInstance(int X, int Y, UHierarchicalInstancedStaticMeshComponent*& OutMesh, int& OutIndex) const
 {
-	HidePreviewMesh();
+	OutMesh = nullptr;
+	OutIndex = INDEX_NONE;
+
+	// Queued cells still show the type they had before the edit
+	const FIntPoint Cell(X, Y);
+	const FGridRenderOp* Op = PendingRenderOps.Find(Cell);
+	FBlockIndex Block;
+	Block.Point = GetRenderChunk(X, Y);
+	Block.Type = Op ? Op->RenderedType : GridSystem->GetTileType(X, Y);
+	if (Block.Type == EGroundType::None)
+	{
+		return false;
+	}
+
+	const FGridInstanceSet* Set = MeshIndex.Find(Block);
+	UHierarchicalInstancedStaticMeshComponent* const* Mesh = GridMeshes.Find(Block);
+	const int32* Index = Set ? Set->Instances.Find(Cell) : nullptr;
+	if (!Index || !Mesh)
+	{
+		return false;
+	}
+	OutMesh = *Mesh;
+	OutIndex = *Index;
+	return true;
+}
 
+void AESGridActor::SetPreviewMesh(const FGridTile& Tile, EGridDirection Direction)
+{
 	CurrentTile = Tile;
+	CurrentShape = GridSystem->RegisterShape(Tile);
 	CurrentDirection = Direction;
 
 	// auto TextureRen
-	TArray<FIntPoint> RotatedShape = UESGridHelper::RotateShape(Tile.Shape, Direction);
 	PreviewMaterial->SetTextureParameterValue(FName("Color"), PreviewGroundMaterials[Tile.Type]);
-	for (auto p : RotatedShape)
+
+	// Validity has to be checked again for the new footprint
+	PreviewEditVersion = INDEX_NONE;
+
+	const int32 Key = GetPreviewKey(CurrentShape, Direction);
+	if (Key == ShownPreviewKey)
+	{
+		return;
+	}
+
+	TArray<FTransform>* Transforms = PreviewTransforms.Find(Key);
+	if (!Transforms)
+	{
+		Transforms = &PreviewTransforms.Add(Key);
+		// Shapes the library refused have nothing to preview
+		if (GridSystem->GetShapeLibrary().IsValid(CurrentShape.ToCore()))
+		{
+			const FGridShapeRotation& Rotation = GridSystem->GetShapeLibrary().Get(CurrentShape.ToCore()).GetRotation(Direction);
+			for (const auto p : Rotation.Cells)
+			{
+				Transforms->Add(GetTileTransform(p.X, p.Y));
+			}
+		}
+	}
+
+	// Reuse the instances already there, only the difference in count is added or removed
+	const int32 Shown = TilePreviewMesh->GetInstanceCount();
+	const int32 Shared = FMath::Min(Shown, Transforms->Num());
+	if (Shown > Transforms->Num())
 	{
-		FTransform Transform = GetTileTransform(p.X, p.Y);
-		TilePreviewMesh->AddInstance(Transform);
+		TArray<int32> Tail;
+		for (int32 Index = Shown - 1; Index >= Transforms->Num(); --Index)
+		{
+			Tail.Add(Index);
+		}
+		TilePreviewMesh->RemoveInstances(Tail);
+	}
+	if (Shared > 0)
+	{
+		TilePreviewMesh->BatchUpdateInstancesTransforms(0, TArrayView<const FTransform>(Transforms->GetData(), Shared), false, true);
+	}
+	if (Transforms->Num() > Shared)
+	{
+		TilePreviewMesh->AddInstances(TArray<FTransform>(Transforms->GetData() + Shared, Transforms->Num() - Shared), false);
 	}
+	ShownPreviewKey = Key;
 
 	// auto Type = Tile.Type;
 	// if (PreviewGroundMaterials.Contains(Type))
@@ -168,22 +469,34 @@ void AESGridActor::SetPreviewMesh(const FGridTile Tile, EGridDirection Direction
 
 void AESGridActor::UpdatePreviewMesh(int X, int Y)
 {
-	// Calculate Correct Transform
-	FTransform Transform = GetTileTransform(X, Y);
-	CurrentTilePreviewLocation = FIntPoint(X, Y);
-	const FVector Location = Transform.GetLocation();
-	Transform.SetLocation(FVector(Location.X - (GridSize * GridSystem->GridSizeX / 2), Location.Y - (GridSize * GridSystem->GridSizeY / 2), 1));
-	Transform.SetScale3D(FVector(1));
-	TilePreviewMesh->SetRelativeTransform(Transform);
+	ES_GRID_SCOPE(UpdatePreview);
 
-	// Check if Tile is Valid
-	if (GridSystem->HasTile(X, Y, CurrentTile, CurrentDirection))
+	const FIntPoint Cell(X, Y);
+	const int32 EditVersion = GridSystem->GetEditVersion();
+	if (Cell == PreviewCell && EditVersion == PreviewEditVersion)
 	{
-		TilePreviewMesh->SetScalarParameterValueOnMaterials(MaterialIsErrorParamName, 1);
+		return;
 	}
-	else
+
+	if (Cell != PreviewCell)
+	{
+		// Calculate Correct Transform
+		FTransform Transform = GetTileTransform(X, Y);
+		CurrentTilePreviewLocation = Cell;
+		PreviewCell = Cell;
+		const FVector Location = Transform.GetLocation();
+		Transform.SetLocation(FVector(Location.X - (GridSize * GridSystem->GridSizeX / 2), Location.Y - (GridSize * GridSystem->GridSizeY / 2), 1));
+		Transform.SetScale3D(FVector(1));
+		TilePreviewMesh->SetRelativeTransform(Transform);
+	}
+
+	// Check if Tile is Valid, the material is only touched when the result changes
+	PreviewEditVersion = EditVersion;
+	const int32 ErrorValue = GridSystem->HasShape(X, Y, CurrentShape, CurrentDirection) ? 1 : 0;
+	if (ErrorValue != PreviewErrorValue)
 	{
-		TilePreviewMesh->SetScalarParameterValueOnMaterials(MaterialIsErrorParamName, 0);
+		PreviewErrorValue = ErrorValue;
+		TilePreviewMesh->SetScalarParameterValueOnMaterials(MaterialIsErrorParamName, ErrorValue);
 	}
 }
 
@@ -198,18 +511,33 @@ void AESGridActor::UpdatePreviewMeshByWorldLocation(const FVector Location)
 	// UE_LOG(LogTemp, Warning, TEXT("GridPosition: %s Pos: %d, %d"), *GridPosition.ToString(), X, Y);
 }
 
+bool AESGridActor::UpdatePreviewMeshByRay(const FVector RayOrigin, const FVector RayDirection)
+{
+	// Like the trace against GroundPlane, only hits inside the grid count
+	FGridPickResult Result;
+	if (!PickGrid(RayOrigin, RayDirection, false, Result))
+	{
+		return false;
+	}
+	UpdatePreviewMesh(Result.Cell.X, Result.Cell.Y);
+	return true;
+}
+
 void AESGridActor::HidePreviewMesh()
 {
 	TilePreviewMesh->ClearInstances();
 	TilePreviewMesh->SetRelativeTransform(FTransform());
+	ShownPreviewKey = INDEX_NONE;
+	PreviewCell = FIntPoint(MAX_int32, MAX_int32);
+	PreviewEditVersion = INDEX_NONE;
 }
 
 bool AESGridActor::ConfirmPlacement()
 {
-	if (GridSystem->CanPlaceTile(CurrentTilePreviewLocation.X, CurrentTilePreviewLocation.Y, CurrentTile, CurrentDirection)
-		&& !GridSystem->HasTile(CurrentTilePreviewLocation.X, CurrentTilePreviewLocation.Y, CurrentTile, CurrentDirection))
+	if (GridSystem->CanPlaceShape(CurrentTilePreviewLocation.X, CurrentTilePreviewLocation.Y, CurrentShape, CurrentDirection)
+		&& !GridSystem->HasShape(CurrentTilePreviewLocation.X, CurrentTilePreviewLocation.Y, CurrentShape, CurrentDirection))
 	{
-		GridSystem->PlaceTile(CurrentTilePreviewLocation.X, CurrentTilePreviewLocation.Y, CurrentTile, CurrentDirection);
+		GridSystem->PlaceShape(CurrentTilePreviewLocation.X, CurrentTilePreviewLocation.Y, CurrentShape, CurrentTile.Type, CurrentDirection);
 		HidePreviewMesh();
 		return true;
 	}
@@ -225,6 +553,130 @@ FVector AESGridActor::GetCenterLocation()
 void AESGridActor::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+
+	if (PendingRenderOps.Num() > 0)
+	{
+		ProcessRenderOps(MaxRenderOpsPerFrame, MaxRenderMillisecondsPerFrame / 1000.0);
+	}
+}
+
+bool AESGridActor::PickGrid(const FVector& RayOrigin, const FVector& RayDirection, bool bFindTile, FGridPickResult& OutResult) const
+{
+	const FTransform GridTransform = GridScene->GetComponentTransform();
+	return PickGridLocal(GridTransform, GridTransform.InverseTransformPosition(RayOrigin), GridTransform.InverseTransformVector(RayDirection),
+	                     GetPickPlaneHeight(GridTransform), bFindTile, OutResult);
+}
+
+void AESGridActor::PickGridBatch(const TArray<FVector>& RayOrigins, const TArray<FVector>& RayDirections, bool bFindTile,
+                                 TArray<FGridPickResult>& OutResults) const
+{
+	const int32 NumRays = FMath::Min(RayOrigins.Num(), RayDirections.Num());
+	const FTransform GridTransform = GridScene->GetComponentTransform();
+	const float PlaneZ = GetPickPlaneHeight(GridTransform);
+
+	OutResults.SetNum(NumRays);
+	for (int32 Ray = 0; Ray < NumRays; ++Ray)
+	{
+		PickGridLocal(GridTransform, GridTransform.InverseTransformPosition(RayOrigins[Ray]),
+		              GridTransform.InverseTransformVector(RayDirections[Ray]), PlaneZ, bFindTile, OutResults[Ray]);
+	}
+}
+
+float AESGridActor::GetPickPlaneHeight(const FTransform& GridTransform) const
+{
+	// Top face of the ground box, where the cursor trace hits
+	const FVector Top = GroundPlane->GetComponentTransform().TransformPosition(FVector(0, 0, GroundPlane->GetUnscaledBoxExtent().Z));
+	return GridTransform.InverseTransformPosition(Top).Z;
+}
+
+bool AESGridActor::PickGridLocal(const FTransform& GridTransform, const FVector& Origin, const FVector& Direction, float PlaneZ,
+                                 bool bFindTile, FGridPickResult& OutResult) const
+{
+	// Grazing rays could walk the whole of an unbounded grid
+	constexpr int32 MaxPickSteps = 1 << 16;
+
+	OutResult = FGridPickResult();
+
+	// Rays parallel to or pointing away from the ground miss it
+	if (FMath::IsNearlyZero(Direction.Z))
+	{
+		return false;
+	}
+	const float HitT = (PlaneZ - Origin.Z) / Direction.Z;
+	if (HitT < 0)
+	{
+		return false;
+	}
+
+	// Cells are mapped like UpdatePreviewMeshByWorldLocation, GridOffset only moves the meshes inside their cell
+	const FVector Hit = Origin + Direction * HitT;
+	OutResult.Location = GridTransform.TransformPosition(Hit);
+	OutResult.Cell = FIntPoint(FMath::FloorToInt(Hit.X / GridSize), FMath::FloorToInt(Hit.Y / GridSize));
+	OutResult.bHitGround = GridSystem->ValidPosition(OutResult.Cell.X, OutResult.Cell.Y);
+	if (!bFindTile)
+	{
+		return OutResult.bHitGround;
+	}
+
+	// Only the part of the ray below the tile tops can hit a tile, clipped to the grid
+	float StartT = FMath::Clamp((PlaneZ + PickTileHeight - Origin.Z) / Direction.Z, 0.0f, HitT);
+	float EndT = HitT;
+	const FIntRect Bounds = GridSystem->GetStorage().GetValidBounds();
+	const FVector2D BoundsMin = FVector2D(Bounds.Min) * GridSize;
+	const FVector2D BoundsMax = FVector2D(Bounds.Max) * GridSize;
+	for (int32 Axis = 0; Axis < 2; ++Axis)
+	{
+		if (FMath::IsNearlyZero(Direction[Axis]))
+		{
+			if (Origin[Axis] < BoundsMin[Axis] || Origin[Axis] >= BoundsMax[Axis])
+			{
+				return OutResult.bHitGround;
+			}
+			continue;
+		}
+		const float T0 = (BoundsMin[Axis] - Origin[Axis]) / Direction[Axis];
+		const float T1 = (BoundsMax[Axis] - Origin[Axis]) / Direction[Axis];
+		StartT = FMath::Max(StartT, FMath::Min(T0, T1));
+		EndT = FMath::Min(EndT, FMath::Max(T0, T1));
+	}
+	if (StartT > EndT)
+	{
+		return OutResult.bHitGround;
+	}
+
+	// Walk every cell the projected segment crosses, in order
+	const FVector2D Start = FVector2D(Origin + Direction * StartT) / GridSize;
+	const FVector2D End = FVector2D(Origin + Direction * EndT) / GridSize;
+	const FVector2D Delta = End - Start;
+	FIntPoint Cell(FMath::FloorToInt(Start.X), FMath::FloorToInt(Start.Y));
+	const FIntPoint EndCell(FMath::FloorToInt(End.X), FMath::FloorToInt(End.Y));
+	const FIntPoint Step(Delta.X >= 0 ? 1 : -1, Delta.Y >= 0 ? 1 : -1);
+	const FVector2D DeltaT(Delta.X != 0 ? FMath::Abs(1.0f / Delta.X) : BIG_NUMBER,
+	                       Delta.Y != 0 ? FMath::Abs(1.0f / Delta.Y) : BIG_NUMBER);
+	FVector2D NextT(Delta.X > 0 ? (Cell.X + 1 - Start.X) * DeltaT.X : Delta.X < 0 ? (Start.X - Cell.X) * DeltaT.X : BIG_NUMBER,
+	                Delta.Y > 0 ? (Cell.Y + 1 - Start.Y) * DeltaT.Y : Delta.Y < 0 ? (Start.Y - Cell.Y) * DeltaT.Y : BIG_NUMBER);
+
+	const int32 Steps = FMath::Min(FMath::Abs(EndCell.X - Cell.X) + FMath::Abs(EndCell.Y - Cell.Y), MaxPickSteps);
+	for (int32 Index = 0; Index <= Steps; ++Index)
+	{
+		if (GridSystem->GetTileType(Cell.X, Cell.Y) != EGroundType::None)
+		{
+			OutResult.bHitTile = true;
+			OutResult.TileCell = Cell;
+			return true;
+		}
+		if (NextT.X < NextT.Y)
+		{
+			Cell.X += Step.X;
+			NextT.X += DeltaT.X;
+		}
+		else
+		{
+			Cell.Y += Step.Y;
+			NextT.Y += DeltaT.Y;
+		}
+	}
+	return OutResult.bHitGround;
 }
 
 FTransform AESGridActor::GetTileTransform(int X, int Y)
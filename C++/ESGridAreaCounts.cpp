@@ -0,0 +1,248 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridAreaCounts.cpp#
+ * Author: Yuyang Qiu
+ * Function:Ground type counts over rectangles from block summaries.
+ */
+
+#include "Core/Grid/ESGridAreaCounts.h"
+
+void FESGridAreaCounts::Reset()
+{
+	Blocks.Reset();
+	bSumsDirty = true;
+}
+
+void FESGridAreaCounts::Write(int32 X, int32 Y, EGroundType OldType, EGroundType NewType)
+{
+	if (OldType == NewType)
+	{
+		return;
+	}
+
+	const FIntPoint Key(X >> FESGridStorage::ChunkShift, Y >> FESGridStorage::ChunkShift);
+	FAreaBlock* Block = Blocks.Find(Key);
+	if (!Block)
+	{
+		if (NewType == GroundTypeNone)
+		{
+			return;
+		}
+		Block = &Blocks.Add(Key);
+		FMemory::Memzero(Block, sizeof(FAreaBlock));
+	}
+
+	const int32 Row = Y & FESGridStorage::ChunkMask;
+	const uint64 Bit = uint64(1) << (X & FESGridStorage::ChunkMask);
+	if (OldType != GroundTypeNone)
+	{
+		Block->Rows[static_cast<int32>(OldType)][Row] &= ~Bit;
+		--Block->Totals[static_cast<int32>(OldType)];
+	}
+	if (NewType != GroundTypeNone)
+	{
+		Block->Rows[static_cast<int32>(NewType)][Row] |= Bit;
+		++Block->Totals[static_cast<int32>(NewType)];
+	}
+	if (OldType == GroundTypeNone)
+	{
+		Block->Rows[0][Row] |= Bit;
+		++Block->Totals[0];
+	}
+	else if (NewType == GroundTypeNone)
+	{
+		Block->Rows[0][Row] &= ~Bit;
+		--Block->Totals[0];
+	}
+
+	if (Block->Totals[0] == 0)
+	{
+		Blocks.Remove(Key);
+	}
+	MarkDirty(Key);
+}
+
+void FESGridAreaCounts::MarkDirty(FIntPoint Block)
+{
+	if (bSumsDirty)
+	{
+		return;
+	}
+	if (!SumBlocks.Contains(Block))
+	{
+		bSumsDirty = true;
+		return;
+	}
+	DirtyRows[Block.Y - SumBlocks.Min.Y] = true;
+	bRowsDirty = true;
+}
+
+int32 FESGridAreaCounts::Count(EGroundType Type, const FIntRect& Rect) const
+{
+	UpdateSums();
+	if (Blocks.Num() == 0)
+	{
+		return 0;
+	}
+
+	// Cells outside the blocks are empty, so huge rectangles only walk the blocks that exist
+	FIntRect Clipped = Rect;
+	Clipped.Clip(FIntRect(SumBlocks.Min * FESGridStorage::ChunkSize, SumBlocks.Max * FESGridStorage::ChunkSize));
+	if (Clipped.Width() <= 0 || Clipped.Height() <= 0)
+	{
+		return 0;
+	}
+
+	const int32 TypeIndex = static_cast<int32>(Type);
+	const FIntPoint First(Clipped.Min.X >> FESGridStorage::ChunkShift, Clipped.Min.Y >> FESGridStorage::ChunkShift);
+	const FIntPoint Last((Clipped.Max.X - 1) >> FESGridStorage::ChunkShift, (Clipped.Max.Y - 1) >> FESGridStorage::ChunkShift);
+
+	// Blocks fully inside the rectangle come from the table
+	const FIntPoint InnerMin((Clipped.Min.X + FESGridStorage::ChunkMask) >> FESGridStorage::ChunkShift,
+	                         (Clipped.Min.Y + FESGridStorage::ChunkMask) >> FESGridStorage::ChunkShift);
+	const FIntPoint InnerMax(Clipped.Max.X >> FESGridStorage::ChunkShift, Clipped.Max.Y >> FESGridStorage::ChunkShift);
+	const bool bInner = InnerMin.X < InnerMax.X && InnerMin.Y < InnerMax.Y;
+
+	int32 Total = 0;
+	if (bInner)
+	{
+		const int32 Stride = SumBlocks.Width() + 1;
+		const TArray<int32>& Table = Sums[TypeIndex];
+		const FIntPoint A = InnerMin - SumBlocks.Min;
+		const FIntPoint B = InnerMax - SumBlocks.Min;
+		for (int32 Row = A.Y; Row < B.Y; ++Row)
+		{
+			Total += Table[Row * Stride + B.X] - Table[Row * Stride + A.X];
+		}
+	}
+
+	// The cut blocks on the border, row by row
+	for (int32 BlockY = First.Y; BlockY <= Last.Y; ++BlockY)
+	{
+		const bool bInnerRow = bInner && BlockY >= InnerMin.Y && BlockY < InnerMax.Y;
+		for (int32 BlockX = First.X; BlockX <= Last.X; ++BlockX)
+		{
+			if (bInnerRow && BlockX == InnerMin.X)
+			{
+				BlockX = InnerMax.X - 1;
+				continue;
+			}
+			Total += CountBlock(TypeIndex, FIntPoint(BlockX, BlockY), Clipped);
+		}
+	}
+	return Total;
+}
+
+void FESGridAreaCounts::GetDensityMap(EGroundType Type, const FIntRect& Area, int32 CellSize, TArray<int32>& OutCounts) const
+{
+	OutCounts.Reset();
+	if (CellSize <= 0 || Area.Width() <= 0 || Area.Height() <= 0)
+	{
+		return;
+	}
+
+	const int32 NumX = FMath::DivideAndRoundUp(Area.Width(), CellSize);
+	const int32 NumY = FMath::DivideAndRoundUp(Area.Height(), CellSize);
+	OutCounts.Reserve(NumX * NumY);
+	for (int32 Y = 0; Y < NumY; ++Y)
+	{
+		for (int32 X = 0; X < NumX; ++X)
+		{
+			const FIntPoint Min = Area.Min + FIntPoint(X, Y) * CellSize;
+			OutCounts.Add(Count(Type, FIntRect(Min, (Min + FIntPoint(CellSize, CellSize)).ComponentMin(Area.Max))));
+		}
+	}
+}
+
+void FESGridAreaCounts::UpdateSums() const
+{
+	if (bSumsDirty)
+	{
+		bSumsDirty = false;
+		if (Blocks.Num() == 0)
+		{
+			SumBlocks = FIntRect();
+			DirtyRows.Empty();
+			bRowsDirty = false;
+			return;
+		}
+
+		FIntPoint Min(MAX_int32, MAX_int32);
+		FIntPoint Max(MIN_int32, MIN_int32);
+		for (const auto& Pair : Blocks)
+		{
+			Min = Min.ComponentMin(Pair.Key);
+			Max = Max.ComponentMax(Pair.Key + FIntPoint(1, 1));
+		}
+		SumBlocks = FIntRect(Min, Max);
+
+		// One zero in front of each row, so a range needs no edge case
+		const int32 Stride = SumBlocks.Width() + 1;
+		for (TArray<int32>& Table : Sums)
+		{
+			Table.Reset();
+			Table.SetNumZeroed(Stride * SumBlocks.Height());
+		}
+		DirtyRows.Init(true, SumBlocks.Height());
+		bRowsDirty = true;
+	}
+
+	if (!bRowsDirty)
+	{
+		return;
+	}
+	for (TConstSetBitIterator<> It(DirtyRows); It; ++It)
+	{
+		SumRow(It.GetIndex());
+	}
+	DirtyRows.SetRange(0, DirtyRows.Num(), false);
+	bRowsDirty = false;
+}
+
+void FESGridAreaCounts::SumRow(int32 Row) const
+{
+	const int32 Stride = SumBlocks.Width() + 1;
+	const int32 BlockY = SumBlocks.Min.Y + Row;
+	int32* Tables[GroundTypeCount];
+	for (int32 Type = 0; Type < GroundTypeCount; ++Type)
+	{
+		Tables[Type] = Sums[Type].GetData() + Row * Stride;
+	}
+	for (int32 X = 0; X < SumBlocks.Width(); ++X)
+	{
+		const FAreaBlock* Block = Blocks.Find(FIntPoint(SumBlocks.Min.X + X, BlockY));
+		for (int32 Type = 0; Type < GroundTypeCount; ++Type)
+		{
+			Tables[Type][X + 1] = Tables[Type][X] + (Block ? Block->Totals[Type] : 0);
+		}
+	}
+}
+
+int32 FESGridAreaCounts::CountBlock(int32 Type, FIntPoint Block, const FIntRect& Rect) const
+{
+	const FAreaBlock* Data = Blocks.Find(Block);
+	if (!Data)
+	{
+		return 0;
+	}
+
+	const FIntPoint Base = Block * FESGridStorage::ChunkSize;
+	const int32 MinX = FMath::Max(Rect.Min.X - Base.X, 0);
+	const int32 MaxX = FMath::Min(Rect.Max.X - Base.X, FESGridStorage::ChunkSize);
+	const int32 MinY = FMath::Max(Rect.Min.Y - Base.Y, 0);
+	const int32 MaxY = FMath::Min(Rect.Max.Y - Base.Y, FESGridStorage::ChunkSize);
+	if (MinX >= MaxX || MinY >= MaxY)
+	{
+		return 0;
+	}
+
+	const int32 Columns = MaxX - MinX;
+	const uint64 Mask = (Columns == 64 ? ~uint64(0) : (uint64(1) << Columns) - 1) << MinX;
+	int32 Count = 0;
+	for (int32 Row = MinY; Row < MaxY; ++Row)
+	{
+		Count += FMath::CountBits(Data->Rows[Type][Row] & Mask);
+	}
+	return Count;
+}
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Grid/ESGridStorage.h"
+
+/**
+ * Cell counts per ground type over any rectangle.
+ * Each 64x64 block keeps one bit row per type and its totals. Every block row keeps prefix sums of the
+ * block totals along X, so the blocks fully inside a rectangle cost one subtraction per block row,
+ * and the cut blocks on its border are counted row by row.
+ * An edit only marks its block row, the first query afterwards re-sums the marked rows. Only a block
+ * outside the covered box rebuilds every row. Queries update the sums, so they are for the owning thread only.
+ */
+class EVEOFTHESTORM_API FESGridAreaCounts
+{
+public:
+	void Reset();
+
+	// Keep the counts in sync with one cell write
+	void Write(int32 X, int32 Y, EGroundType OldType, EGroundType NewType);
+
+	// Cells of Type in Rect (max exclusive), None counts every non-empty cell
+	int32 Count(EGroundType Type, const FIntRect& Rect) const;
+
+	// Every cell in Rect is ground, of Type unless it is None
+	bool IsFilled(EGroundType Type, const FIntRect& Rect) const { return Count(Type, Rect) == Rect.Area(); }
+
+	// Counts of CellSize x CellSize squares covering Area, row by row
+	void GetDensityMap(EGroundType Type, const FIntRect& Area, int32 CellSize, TArray<int32>& OutCounts) const;
+
+private:
+	struct FAreaBlock
+	{
+		// Entry 0 holds every non-empty cell
+		uint64 Rows[GroundTypeCount][FESGridStorage::ChunkSize];
+
+		int32 Totals[GroundTypeCount];
+	};
+
+	void UpdateSums() const;
+
+	// Prefix sums of one block row of SumBlocks, Row relative to SumBlocks.Min.Y
+	void SumRow(int32 Row) const;
+
+	void MarkDirty(FIntPoint Block);
+
+	// Cells of Type inside one block, clipped to the block
+	int32 CountBlock(int32 Type, FIntPoint Block, const FIntRect& Rect) const;
+
+	TMap<FIntPoint, FAreaBlock> Blocks;
+
+	// Prefix sums of the block totals along each block row, Height x (Width + 1) entries per type
+	mutable TArray<int32> Sums[GroundTypeCount];
+
+	// Blocks covered by Sums, max exclusive
+	mutable FIntRect SumBlocks;
+
+	// Block rows of SumBlocks whose sums are out of date
+	mutable TBitArray<> DirtyRows;
+
+	mutable bool bRowsDirty = false;
+
+	// SumBlocks no longer covers every block, all rows are rebuilt
+	mutable bool bSumsDirty = true;
+};
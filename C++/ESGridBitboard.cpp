@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridBitboard.cpp#
+ * Author: Yuyang Qiu
+ * Function:Word-wide occupancy tests for placing shapes on the grid.
+ */
+
+#include "Core/Grid/ESGridBitboard.h"
+
+#include "Core/Grid/ESGridShapeLibrary.h"
+
+#if defined(__AVX2__)
+#define ES_GRID_BITBOARD_AVX2 1
+#else
+#define ES_GRID_BITBOARD_AVX2 0
+#endif
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS && (defined(_M_X64) || defined(__x86_64__))
+#define ES_GRID_BITBOARD_SSE 1
+#else
+#define ES_GRID_BITBOARD_SSE 0
+#endif
+
+#if ES_GRID_BITBOARD_AVX2 || ES_GRID_BITBOARD_SSE
+#include <immintrin.h>
+#endif
+
+void FESGridBitboard::Initialize(const FESGridStorage& InStorage)
+{
+	Storage = &InStorage;
+	bChunked = InStorage.IsChunked();
+	Height = InStorage.GetHeight();
+	WordsPerRow = FMath::DivideAndRoundUp(InStorage.GetWidth(), 64);
+
+	const int32 NumWords = bChunked ? InStorage.GetCapacity() / 64 : WordsPerRow * Height;
+	Words.Empty(NumWords);
+	Words.SetNumZeroed(NumWords);
+}
+
+void FESGridBitboard::Reset()
+{
+	if (bChunked)
+	{
+		Words.Reset();
+		SyncCapacity();
+		return;
+	}
+	FMemory::Memzero(Words.GetData(), Words.Num() * sizeof(uint64));
+}
+
+void FESGridBitboard::SyncCapacity()
+{
+	if (bChunked && Words.Num() < Storage->GetCapacity() / 64)
+	{
+		// Released slots are reused with all their bits already cleared
+		Words.AddZeroed(Storage->GetCapacity() / 64 - Words.Num());
+	}
+}
+
+void FESGridBitboard::TestShape(const FESGridBitboard& Occupied, const FESGridBitboard& Adjacent,
+                                int32 X, int32 Y, const FGridShapeRotation& Shape,
+                                bool& bOutOverlaps, bool& bOutTouches)
+{
+	const int32 Left = X + Shape.Min.X;
+	const int32 Top = Y + Shape.Min.Y;
+	const uint64* Masks = Shape.RowMasks.GetData();
+	const int32 Rows = Shape.RowMasks.Num();
+
+	int32 Row = 0;
+	uint64 OverlapBits = 0;
+	uint64 TouchBits = 0;
+
+#if ES_GRID_BITBOARD_AVX2
+	// Four rows per step
+	__m256i OverlapAcc = _mm256_setzero_si256();
+	__m256i TouchAcc = _mm256_setzero_si256();
+	for (; Row + 4 <= Rows; Row += 4)
+	{
+		const __m256i Mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Masks + Row));
+		const __m256i OccupiedRows = _mm256_set_epi64x(
+			Occupied.GetBits(Left, Top + Row + 3), Occupied.GetBits(Left, Top + Row + 2),
+			Occupied.GetBits(Left, Top + Row + 1), Occupied.GetBits(Left, Top + Row));
+		const __m256i AdjacentRows = _mm256_set_epi64x(
+			Adjacent.GetBits(Left, Top + Row + 3), Adjacent.GetBits(Left, Top + Row + 2),
+			Adjacent.GetBits(Left, Top + Row + 1), Adjacent.GetBits(Left, Top + Row));
+		OverlapAcc = _mm256_or_si256(OverlapAcc, _mm256_and_si256(OccupiedRows, Mask));
+		TouchAcc = _mm256_or_si256(TouchAcc, _mm256_and_si256(AdjacentRows, Mask));
+	}
+	OverlapBits |= _mm256_testz_si256(OverlapAcc, OverlapAcc) ? 0 : 1;
+	TouchBits |= _mm256_testz_si256(TouchAcc, TouchAcc) ? 0 : 1;
+#endif
+
+#if ES_GRID_BITBOARD_SSE
+	// Two rows per step, SSE2 only
+	__m128i OverlapAcc2 = _mm_setzero_si128();
+	__m128i TouchAcc2 = _mm_setzero_si128();
+	for (; Row + 2 <= Rows; Row += 2)
+	{
+		const __m128i Mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Masks + Row));
+		const __m128i OccupiedRows = _mm_set_epi64x(
+			Occupied.GetBits(Left, Top + Row + 1), Occupied.GetBits(Left, Top + Row));
+		const __m128i AdjacentRows = _mm_set_epi64x(
+			Adjacent.GetBits(Left, Top + Row + 1), Adjacent.GetBits(Left, Top + Row));
+		OverlapAcc2 = _mm_or_si128(OverlapAcc2, _mm_and_si128(OccupiedRows, Mask));
+		TouchAcc2 = _mm_or_si128(TouchAcc2, _mm_and_si128(AdjacentRows, Mask));
+	}
+	const __m128i Zero = _mm_setzero_si128();
+	OverlapBits |= _mm_movemask_epi8(_mm_cmpeq_epi8(OverlapAcc2, Zero)) == 0xFFFF ? 0 : 1;
+	TouchBits |= _mm_movemask_epi8(_mm_cmpeq_epi8(TouchAcc2, Zero)) == 0xFFFF ? 0 : 1;
+#endif
+
+	for (; Row < Rows; ++Row)
+	{
+		OverlapBits |= Occupied.GetBits(Left, Top + Row) & Masks[Row];
+		TouchBits |= Adjacent.GetBits(Left, Top + Row) & Masks[Row];
+	}
+
+	bOutOverlaps = OverlapBits != 0;
+	bOutTouches = TouchBits != 0;
+}
+
+int32 FESGridBitboard::CountShape(const FESGridBitboard& Board, int32 X, int32 Y, const FGridShapeRotation& Shape)
+{
+	const int32 Left = X + Shape.Min.X;
+	const int32 Top = Y + Shape.Min.Y;
+	int32 Count = 0;
+	for (int32 Row = 0; Row < Shape.RowMasks.Num(); ++Row)
+	{
+		Count += FMath::CountBits(Board.GetBits(Left, Top + Row) & Shape.RowMasks[Row]);
+	}
+	return Count;
+}
@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Grid/ESGridStorage.h"
+
+struct FGridShapeRotation;
+
+/**
+ * One bit per grid cell, 64 columns per word.
+ * Dense grids store rows one after another, chunked grids store one word per chunk row
+ * at the chunk's storage slot. Bits outside the grid are always zero so shifted reads never see garbage.
+ */
+class EVEOFTHESTORM_API FESGridBitboard
+{
+public:
+	// Storage must outlive the bitboard
+	void Initialize(const FESGridStorage& InStorage);
+
+	void Reset();
+
+	// Grow with the storage after chunks were added
+	void SyncCapacity();
+
+	int32 GetWordsPerRow() const { return WordsPerRow; }
+
+	FORCEINLINE bool Get(int32 X, int32 Y) const
+	{
+		return ((GetWord(X >> 6, Y) >> (X & 63)) & 1) != 0;
+	}
+
+	FORCEINLINE void Set(int32 X, int32 Y, bool bValue)
+	{
+		const int32 WordIndex = FindWordIndex(X >> 6, Y);
+		check(WordIndex != INDEX_NONE);
+		uint64& Word = Words[WordIndex];
+		const uint64 Bit = uint64(1) << (X & 63);
+		Word = bValue ? (Word | Bit) : (Word & ~Bit);
+	}
+
+	// Set several bits of one word at once, the word must exist
+	FORCEINLINE void OrWord(int32 WordX, int32 Y, uint64 Bits)
+	{
+		const int32 WordIndex = FindWordIndex(WordX, Y);
+		check(WordIndex != INDEX_NONE);
+		Words[WordIndex] |= Bits;
+	}
+
+	// Word covering columns [WordX * 64, WordX * 64 + 63] of row Y, zero outside the grid
+	FORCEINLINE uint64 GetWord(int32 WordX, int32 Y) const
+	{
+		const int32 WordIndex = FindWordIndex(WordX, Y);
+		return WordIndex == INDEX_NONE ? 0 : Words[WordIndex];
+	}
+
+	// 64 bits of row Y starting at column X, which may be negative
+	FORCEINLINE uint64 GetBits(int32 X, int32 Y) const
+	{
+		const int32 WordX = X >> 6;
+		const int32 Shift = X & 63;
+		const uint64 Low = GetWord(WordX, Y) >> Shift;
+		return Shift == 0 ? Low : Low | (GetWord(WordX + 1, Y) << (64 - Shift));
+	}
+
+	/**
+	 * Test a shape footprint anchored at (X, Y) against two boards at once.
+	 * bOutOverlaps is set when any cell hits Occupied, bOutTouches when any cell hits Adjacent.
+	 */
+	static void TestShape(const FESGridBitboard& Occupied, const FESGridBitboard& Adjacent,
+	                      int32 X, int32 Y, const FGridShapeRotation& Shape,
+	                      bool& bOutOverlaps, bool& bOutTouches);
+
+	// Number of shape cells anchored at (X, Y) whose bit is set in Board
+	static int32 CountShape(const FESGridBitboard& Board, int32 X, int32 Y, const FGridShapeRotation& Shape);
+
+private:
+	FORCEINLINE int32 FindWordIndex(int32 WordX, int32 Y) const
+	{
+		if (bChunked)
+		{
+			// Chunks are exactly one word wide
+			const int32 Slot = Storage->FindSlot(WordX, Y >> FESGridStorage::ChunkShift);
+			return Slot == INDEX_NONE ? INDEX_NONE : Slot * FESGridStorage::ChunkSize + (Y & FESGridStorage::ChunkMask);
+		}
+		if (Y < 0 || Y >= Height || WordX < 0 || WordX >= WordsPerRow)
+		{
+			return INDEX_NONE;
+		}
+		return Y * WordsPerRow + WordX;
+	}
+
+	const FESGridStorage* Storage = nullptr;
+
+	TArray<uint64> Words;
+
+	int32 Height = 0;
+
+	int32 WordsPerRow = 0;
+
+	bool bChunked = false;
+};
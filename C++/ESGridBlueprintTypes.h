@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Types/GroundType.h"
+#include "Core/Grid/ESGridType.h"
+#include "Core/Grid/ESGridCore.h"
+#include "ESGridBlueprintTypes.generated.h"
+
+// Reflected mirrors of the grid core types, the core itself stays free of UHT
+
+UENUM(BlueprintType)
+enum class EGridStorageLayout : uint8
+{
+	// Cells stored row by row, X changes fastest.
+	RowMajor,
+	// Cells grouped in 8x8 blocks so a cell and its neighbours share one or two cache lines.
+	Tiled,
+	// 64x64 chunks allocated on first use and released once nothing references them.
+	Chunked
+};
+
+static_assert(static_cast<uint8>(EGridStorageLayout::Chunked) == static_cast<uint8>(EESGridStorageLayout::Chunked),
+              "EGridStorageLayout has to mirror EESGridStorageLayout");
+
+UENUM(BlueprintType)
+enum class EGridBoundsMode : uint8
+{
+	// Positions inside [0, Width) x [0, Height) are valid.
+	Fixed,
+	// Every position is valid, negative ones included. Needs the chunked layout.
+	Unbounded
+};
+
+static_assert(static_cast<uint8>(EGridBoundsMode::Unbounded) == static_cast<uint8>(EESGridBoundsMode::Unbounded),
+              "EGridBoundsMode has to mirror EESGridBoundsMode");
+
+static_assert(static_cast<uint8>(EGroundType::None) == static_cast<uint8>(GroundTypeNone), "The grid core expects None to be 0");
+
+static_assert(static_cast<uint8>(EGridDirection::North) == static_cast<uint8>(GridDirectionNorth), "The grid core expects North to be 0");
+
+/**
+ * GroundTypeCount and GridDirectionCount against the reflected enums, without the generated _MAX entry.
+ * The enums have no count member to assert on at compile time, so this runs when the grid system is constructed.
+ */
+FORCEINLINE void CheckGridEnumCounts()
+{
+	checkf(StaticEnum<EGroundType>()->NumEnums() - 1 == GroundTypeCount,
+	       TEXT("GroundTypeCount is %d but EGroundType has %d values, update ESGridCoreTypes.h"),
+	       GroundTypeCount, StaticEnum<EGroundType>()->NumEnums() - 1);
+	checkf(StaticEnum<EGridDirection>()->NumEnums() - 1 == GridDirectionCount,
+	       TEXT("GridDirectionCount is %d but EGridDirection has %d values, update ESGridCoreTypes.h"),
+	       GridDirectionCount, StaticEnum<EGridDirection>()->NumEnums() - 1);
+}
+
+FORCEINLINE EESGridStorageLayout ToCore(EGridStorageLayout Layout) { return static_cast<EESGridStorageLayout>(Layout); }
+
+FORCEINLINE EGridStorageLayout ToBlueprint(EESGridStorageLayout Layout) { return static_cast<EGridStorageLayout>(Layout); }
+
+FORCEINLINE EESGridBoundsMode ToCore(EGridBoundsMode Bounds) { return static_cast<EESGridBoundsMode>(Bounds); }
+
+FORCEINLINE EGridBoundsMode ToBlueprint(EESGridBoundsMode Bounds) { return static_cast<EGridBoundsMode>(Bounds); }
+
+USTRUCT(BlueprintType)
+struct FGridShapeHandle
+{
+	GENERATED_BODY()
+
+		UPROPERTY(BlueprintReadOnly)
+		int32 Index = INDEX_NONE;
+
+	// Library that issued the handle, not visible to Blueprint so handles cannot be forged there
+	uint32 Library = 0;
+
+	FGridShapeHandle() = default;
+
+	explicit FGridShapeHandle(const FESGridShapeHandle& Handle) : Index(Handle.Index), Library(Handle.Library)
+	{
+	}
+
+	FESGridShapeHandle ToCore() const
+	{
+		FESGridShapeHandle Handle;
+		Handle.Index = Index;
+		Handle.Library = Library;
+		return Handle;
+	}
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+
+	friend uint32 GetTypeHash(const FGridShapeHandle& Handle)
+	{
+		return GetTypeHash(Handle.Index);
+	}
+
+	bool operator==(const FGridShapeHandle& Other) const
+	{
+		return Index == Other.Index && Library == Other.Library;
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FGridPlacement
+{
+	GENERATED_BODY()
+
+		UPROPERTY(BlueprintReadOnly)
+		int32 X = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+		int32 Y = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+		EGridDirection Direction = EGridDirection::North;
+
+	// Shape cells touching existing ground, only filled by ranked queries
+	UPROPERTY(BlueprintReadOnly)
+		int32 Score = 0;
+
+	FGridPlacement() = default;
+
+	explicit FGridPlacement(const FESGridPlacement& Placement)
+		: X(Placement.X), Y(Placement.Y), Direction(Placement.Direction), Score(Placement.Score)
+	{
+	}
+};
+
+FORCEINLINE TArray<FGridPlacement> ToBlueprint(const TArray<FESGridPlacement>& Placements)
+{
+	TArray<FGridPlacement> Result;
+	Result.Reserve(Placements.Num());
+	for (const FESGridPlacement& Placement : Placements)
+	{
+		Result.Emplace(Placement);
+	}
+	return Result;
+}
@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Grid/ESGridStorage.h"
+
+/**
+ * Sparse set of grid cell indices.
+ * Add, Remove and Contains are O(1), iteration only visits the members.
+ * Slots are validated against the members, so the per-cell table is never cleared.
+ */
+class FESGridCellSet
+{
+public:
+	// Capacity is the number of addressable cells, indices must be below it
+	void Initialize(int32 Capacity)
+	{
+		Dense.Reset();
+		Sparse.Empty(Capacity);
+		Sparse.SetNumUninitialized(Capacity);
+	}
+
+	void Reset()
+	{
+		Dense.Reset();
+	}
+
+	// Make room for indices added by a growing storage, members are kept
+	void Grow(int32 Capacity)
+	{
+		if (Capacity > Sparse.Num())
+		{
+			Sparse.AddUninitialized(Capacity - Sparse.Num());
+		}
+	}
+
+	FORCEINLINE bool Contains(int32 Index) const
+	{
+		const uint32 Slot = static_cast<uint32>(Sparse[Index]);
+		return Slot < static_cast<uint32>(Dense.Num()) && Dense[Slot] == Index;
+	}
+
+	FORCEINLINE bool Add(int32 Index)
+	{
+		if (Contains(Index))
+		{
+			return false;
+		}
+		Sparse[Index] = Dense.Add(Index);
+		return true;
+	}
+
+	// Swaps the last member into the freed slot, so iteration order is not stable
+	FORCEINLINE bool Remove(int32 Index)
+	{
+		if (!Contains(Index))
+		{
+			return false;
+		}
+		const int32 Slot = Sparse[Index];
+		const int32 Last = Dense.Last();
+		Dense[Slot] = Last;
+		Sparse[Last] = Slot;
+		Dense.Pop(false);
+		return true;
+	}
+
+	int32 Num() const { return Dense.Num(); }
+
+	int32 operator[](int32 Slot) const { return Dense[Slot]; }
+
+	const TArray<int32>& GetIndices() const { return Dense; }
+
+	TArray<int32>::RangedForConstIteratorType begin() const { return Dense.begin(); }
+
+	TArray<int32>::RangedForConstIteratorType end() const { return Dense.end(); }
+
+private:
+	TArray<int32> Dense;
+
+	TArray<int32> Sparse;
+};
+
+/**
+ * Cells of every non-empty ground type.
+ * A cell has a single type, so the sets share one slot per cell and only store their own members.
+ */
+class FESGridTypedCellSets
+{
+public:
+	void Initialize(int32 Capacity)
+	{
+		for (TArray<int32>& Cells : Dense)
+		{
+			Cells.Reset();
+		}
+		Slots.Empty(Capacity);
+		Slots.SetNumUninitialized(Capacity);
+	}
+
+	void Grow(int32 Capacity)
+	{
+		if (Capacity > Slots.Num())
+		{
+			Slots.AddUninitialized(Capacity - Slots.Num());
+		}
+	}
+
+	FORCEINLINE bool Contains(EGroundType Type, int32 Index) const
+	{
+		const TArray<int32>& Cells = Get(Type);
+		const uint32 Slot = static_cast<uint32>(Slots[Index]);
+		return Slot < static_cast<uint32>(Cells.Num()) && Cells[Slot] == Index;
+	}
+
+	FORCEINLINE void Add(EGroundType Type, int32 Index)
+	{
+		checkSlow(!Contains(Type, Index));
+		Slots[Index] = GetMutable(Type).Add(Index);
+	}
+
+	// Swaps the last member into the freed slot, so iteration order is not stable
+	FORCEINLINE void Remove(EGroundType Type, int32 Index)
+	{
+		checkSlow(Contains(Type, Index));
+		TArray<int32>& Cells = GetMutable(Type);
+		const int32 Slot = Slots[Index];
+		const int32 Last = Cells.Last();
+		Cells[Slot] = Last;
+		Slots[Last] = Slot;
+		Cells.Pop(false);
+	}
+
+	// Members of one non-empty type, as storage indices
+	FORCEINLINE const TArray<int32>& Get(EGroundType Type) const
+	{
+		checkSlow(Type != GroundTypeNone);
+		return Dense[static_cast<int32>(Type) - 1];
+	}
+
+	int32 Num(EGroundType Type) const { return Get(Type).Num(); }
+
+private:
+	FORCEINLINE TArray<int32>& GetMutable(EGroundType Type)
+	{
+		checkSlow(Type != GroundTypeNone);
+		return Dense[static_cast<int32>(Type) - 1];
+	}
+
+	// None has no set
+	TArray<int32> Dense[GroundTypeCount - 1];
+
+	// Position of each occupied cell in the set of its type
+	TArray<int32> Slots;
+};
@@ -0,0 +1,703 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridCore.cpp#
+ * Author: Yuyang Qiu
+ * Function:Grid storage and placement logic shared by the grid system and standalone tools.
+ */
+
+#include "Core/Grid/ESGridCore.h"
+
+#include "Core/Grid/ESGridStats.h"
+
+void FESGridCore::Initialize(int32 Width, int32 Height, EESGridStorageLayout Layout, EESGridBoundsMode Bounds)
+{
+	Grid.Initialize(Width, Height, Layout, Bounds);
+	OccupiedBits.Initialize(Grid);
+	AdjacentBits.Initialize(Grid);
+	NeighbourCounts.Empty(Grid.GetCapacity());
+	NeighbourCounts.SetNumZeroed(Grid.GetCapacity());
+	Frontier.Initialize(Grid.GetCapacity());
+	OccupiedCells.Initialize(Grid.GetCapacity());
+	AreaCounts.Reset();
+	EditDepth = 0;
+	PendingBatch = FGridEditBatch();
+	PendingChangeIndex.Reset();
+
+	// Bulk writes skip the dirty tracking, the next snapshot starts over
+	bTrackSnapshotBlocks = false;
+	SnapshotBlocks.Reset();
+	DirtyBlocks.Reset();
+	MarkEdited(FIntRect(0, 0, Width, Height));
+}
+
+void FESGridCore::RunParallel(int32 Num, TFunctionRef<void(int32)> Body) const
+{
+	if (ParallelForFunc && Num > 1)
+	{
+		ParallelForFunc(Num, Body);
+		return;
+	}
+	for (int32 i = 0; i < Num; ++i)
+	{
+		Body(i);
+	}
+}
+
+FESGridShapeHandle FESGridCore::ResolveShape(const TArray<FIntPoint>& Shape) const
+{
+	const FESGridShapeHandle Handle = ShapeLibrary.Find(Shape);
+	return Handle.IsValid() ? Handle : ShapeLibrary.Register(Shape);
+}
+
+bool FESGridCore::HasShape(int32 X, int32 Y, FESGridShapeHandle Shape, EGridDirection Direction) const
+{
+	ES_GRID_SCOPE(HasShape);
+
+	const FGridShapeRotation& Rotation = ShapeLibrary.Get(Shape).GetRotation(Direction);
+
+	bool bOverlaps;
+	bool bTouches;
+	FESGridBitboard::TestShape(OccupiedBits, AdjacentBits, X, Y, Rotation, bOverlaps, bTouches);
+	return !bTouches || bOverlaps;
+}
+
+bool FESGridCore::CanPlaceShape(int32 X, int32 Y, FESGridShapeHandle Shape, EGridDirection Direction) const
+{
+	ES_GRID_SCOPE(CanPlaceShape);
+
+	const FGridShapeRotation& Rotation = ShapeLibrary.Get(Shape).GetRotation(Direction);
+
+	bool bOverlaps;
+	bool bTouches;
+	FESGridBitboard::TestShape(OccupiedBits, AdjacentBits, X, Y, Rotation, bOverlaps, bTouches);
+	if (!bTouches)
+	{
+		return false;
+	}
+
+	// Every cell is inside the grid when both corners of the bounds are
+	return IsValid(X + Rotation.Min.X, Y + Rotation.Min.Y) &&
+		IsValid(X + Rotation.Max.X, Y + Rotation.Max.Y);
+}
+
+bool FESGridCore::PlaceShape(int32 X, int32 Y, FESGridShapeHandle Shape, EGroundType Type, EGridDirection Direction)
+{
+	if (!HasShape(X, Y, Shape, Direction))
+	{
+		SetShape(X, Y, ShapeLibrary.Get(Shape).GetRotation(Direction), Type);
+		return true;
+	}
+	return false;
+}
+
+void FESGridCore::RemoveShape(int32 X, int32 Y, FESGridShapeHandle Shape, EGridDirection Direction)
+{
+	if (CanPlaceShape(X, Y, Shape, Direction))
+	{
+		SetShape(X, Y, ShapeLibrary.Get(Shape).GetRotation(Direction), GroundTypeNone);
+	}
+}
+
+void FESGridCore::UpdateShape(int32 X, int32 Y, FESGridShapeHandle Shape, EGroundType Type, EGridDirection Direction)
+{
+	if (CanPlaceShape(X, Y, Shape, Direction))
+	{
+		SetShape(X, Y, ShapeLibrary.Get(Shape).GetRotation(Direction), Type);
+	}
+}
+
+void FESGridCore::SetShape(int32 X, int32 Y, const FGridShapeRotation& Shape, EGroundType Type)
+{
+	ES_GRID_SCOPE(SetShape);
+
+	// The footprint is one edit, the batch itself only reaches callers that opened their own transaction
+	BeginEdit();
+	for (const auto p : Shape.Cells)
+	{
+		if (!Grid.IsValid(X + p.X, Y + p.Y)) continue;
+
+		WriteCell(X + p.X, Y + p.Y, Type);
+	}
+	FGridEditBatch Batch;
+	CommitEdit(Batch);
+}
+
+bool FESGridCore::IsGroundValid(int32 X, int32 Y, const TArray<FIntPoint>& Shape, EGroundType InGroundType) const
+{
+	for (const auto p : Shape)
+	{
+		if (InGroundType == GroundTypeNone)
+		{
+			if (Grid.Get(X + p.X, Y + p.Y) == GroundTypeNone)
+			{
+				return false;
+			}
+		}
+		else if (Grid.Get(X + p.X, Y + p.Y) != InGroundType)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+TArray<FIntPoint> FESGridCore::GetPointsOfType(EGroundType Type, int32 Count) const
+{
+	const int32 Total = GetOccupiedCount(Type);
+	const int32 Limit = Count > 0 ? FMath::Min(Count, Total) : Total;
+
+	TArray<FIntPoint> Result;
+	Result.Reserve(Limit);
+	for (int32 i = 1; i < GroundTypeCount && Result.Num() < Limit; ++i)
+	{
+		if (Type != GroundTypeNone && i != static_cast<int32>(Type)) continue;
+
+		for (const int32 Index : OccupiedCells.Get(static_cast<EGroundType>(i)))
+		{
+			if (Result.Num() == Limit) break;
+
+			Result.Add(Grid.ToPoint(Index));
+		}
+	}
+	return Result;
+}
+
+int32 FESGridCore::GetOccupiedCount(EGroundType Type) const
+{
+	if (Type != GroundTypeNone)
+	{
+		return OccupiedCells.Num(Type);
+	}
+
+	int32 Total = 0;
+	for (int32 i = 1; i < GroundTypeCount; ++i)
+	{
+		Total += OccupiedCells.Num(static_cast<EGroundType>(i));
+	}
+	return Total;
+}
+
+bool FESGridCore::GetRandomPoint(const FRandomStream& Stream, FIntPoint& OutPoint, EGroundType Type) const
+{
+	const int32 Total = GetOccupiedCount(Type);
+	if (Total == 0)
+	{
+		return false;
+	}
+
+	int32 Pick = Stream.RandRange(0, Total - 1);
+	for (int32 i = 1; i < GroundTypeCount; ++i)
+	{
+		if (Type != GroundTypeNone && i != static_cast<int32>(Type)) continue;
+
+		const TArray<int32>& Cells = OccupiedCells.Get(static_cast<EGroundType>(i));
+		if (Pick < Cells.Num())
+		{
+			OutPoint = Grid.ToPoint(Cells[Pick]);
+			return true;
+		}
+		Pick -= Cells.Num();
+	}
+	return false;
+}
+
+TArray<FESGridPlacement> FESGridCore::FindShapePlacements(FESGridShapeHandle Shape, const FIntRect* Region, bool bRanked,
+	int32 MaxResults) const
+{
+	const FIntRect* Regions[GridDirectionCount] = {Region, Region, Region, Region};
+
+	TArray<FESGridPlacement> Result;
+	CollectPlacements(ShapeLibrary.Get(Shape), Regions, bRanked, Result);
+
+	if (bRanked)
+	{
+		Result.StableSort([](const FESGridPlacement& A, const FESGridPlacement& B)
+		{
+			return A.Score > B.Score;
+		});
+	}
+	if (MaxResults > 0 && Result.Num() > MaxResults)
+	{
+		Result.SetNum(MaxResults);
+	}
+	return Result;
+}
+
+void FESGridCore::UpdatePlacementSet(FESGridPlacementSet& Set) const
+{
+	if (Set.Version == EditVersion)
+	{
+		return;
+	}
+
+	// Missed more than one edit, the last edit rect is not enough to patch the set
+	if (Set.Version != EditVersion - 1)
+	{
+		Set.Placements = FindShapePlacements(Set.Shape);
+		Set.Version = EditVersion;
+		return;
+	}
+
+	// An edit can only change anchors whose footprint covers the edited cells or the ring around them
+	const FGridShape& Shape = ShapeLibrary.Get(Set.Shape);
+	FIntRect Affected[GridDirectionCount];
+	const FIntRect* Regions[GridDirectionCount];
+	for (int32 i = 0; i < GridDirectionCount; ++i)
+	{
+		const FGridShapeRotation& Rotation = Shape.Rotations[i];
+		Affected[i] = FIntRect(LastEditRect.Min - FIntPoint(1, 1) - Rotation.Max,
+		                       LastEditRect.Max + FIntPoint(1, 1) - Rotation.Min);
+		Regions[i] = &Affected[i];
+	}
+
+	Set.Placements.RemoveAll([&Affected](const FESGridPlacement& Placement)
+	{
+		return Affected[static_cast<int32>(Placement.Direction)].Contains(FIntPoint(Placement.X, Placement.Y));
+	});
+	CollectPlacements(Shape, Regions, false, Set.Placements);
+	Set.Version = EditVersion;
+}
+
+void FESGridCore::CollectPlacements(const FGridShape& Shape, const FIntRect* const* Regions, bool bRanked,
+	TArray<FESGridPlacement>& OutPlacements) const
+{
+	ES_GRID_SCOPE(FindPlacements);
+
+	// Anchors per direction that keep the whole footprint inside the grid
+	const FIntRect Bounds = Grid.GetValidBounds();
+	FIntRect Anchors[GridDirectionCount];
+	int32 MinY = MAX_int32;
+	int32 MaxY = MIN_int32;
+	int64 ScanCost = 0;
+	int64 FrontierCost = 0;
+	for (int32 i = 0; i < GridDirectionCount; ++i)
+	{
+		const FGridShapeRotation& Rotation = Shape.Rotations[i];
+		if (Rotation.Cells.Num() == 0)
+		{
+			continue;
+		}
+
+		FIntRect& Range = Anchors[i];
+		Range = FIntRect(Bounds.Min - Rotation.Min, Bounds.Max - Rotation.Max);
+		if (Regions[i])
+		{
+			Range.Clip(*Regions[i]);
+		}
+		if (Range.Width() > 0 && Range.Height() > 0)
+		{
+			MinY = FMath::Min(MinY, Range.Min.Y);
+			MaxY = FMath::Max(MaxY, Range.Max.Y);
+			ScanCost += int64(Range.Width()) * Range.Height();
+			FrontierCost += int64(Frontier.Num()) * Rotation.Cells.Num();
+		}
+	}
+	if (MinY >= MaxY)
+	{
+		return;
+	}
+
+	// A valid placement always covers a frontier cell, so a small frontier beats scanning the region
+	if (FrontierCost < ScanCost)
+	{
+		CollectFrontierPlacements(Shape, Anchors, bRanked, OutPlacements);
+		return;
+	}
+
+	// Rows are split in chunks, each chunk fills its own list so the merge keeps row order
+	constexpr int32 RowsPerChunk = 8;
+	const int32 NumChunks = FMath::DivideAndRoundUp(MaxY - MinY, RowsPerChunk);
+	TArray<TArray<FESGridPlacement>> ChunkResults;
+	ChunkResults.SetNum(NumChunks);
+
+	RunParallel(NumChunks, [&](int32 Chunk)
+	{
+		TArray<FESGridPlacement>& Out = ChunkResults[Chunk];
+		const int32 RowEnd = FMath::Min(MinY + (Chunk + 1) * RowsPerChunk, MaxY);
+		for (int32 Y = MinY + Chunk * RowsPerChunk; Y < RowEnd; ++Y)
+		{
+			for (int32 i = 0; i < GridDirectionCount; ++i)
+			{
+				const FIntRect& Range = Anchors[i];
+				if (Y < Range.Min.Y || Y >= Range.Max.Y || Range.Min.X >= Range.Max.X)
+				{
+					continue;
+				}
+
+				// Skip the band quickly when no footprint row can touch ground
+				const FGridShapeRotation& Rotation = Shape.Rotations[i];
+				const int32 FirstWord = (Range.Min.X + Rotation.Min.X) >> 6;
+				const int32 LastWord = (Range.Max.X - 1 + Rotation.Max.X) >> 6;
+				uint64 Band = 0;
+				for (int32 Row = Y + Rotation.Min.Y; Row <= Y + Rotation.Max.Y; ++Row)
+				{
+					for (int32 Word = FirstWord; Word <= LastWord; ++Word)
+					{
+						Band |= AdjacentBits.GetWord(Word, Row);
+					}
+				}
+				if (Band == 0)
+				{
+					continue;
+				}
+
+				for (int32 X = Range.Min.X; X < Range.Max.X; ++X)
+				{
+					bool bOverlaps;
+					bool bTouches;
+					FESGridBitboard::TestShape(OccupiedBits, AdjacentBits, X, Y, Rotation, bOverlaps, bTouches);
+					if (bTouches && !bOverlaps)
+					{
+						FESGridPlacement& Placement = Out.AddDefaulted_GetRef();
+						Placement.X = X;
+						Placement.Y = Y;
+						Placement.Direction = static_cast<EGridDirection>(i);
+						if (bRanked)
+						{
+							Placement.Score = FESGridBitboard::CountShape(AdjacentBits, X, Y, Rotation);
+						}
+					}
+				}
+			}
+		}
+	});
+
+	for (TArray<FESGridPlacement>& Chunk : ChunkResults)
+	{
+		OutPlacements.Append(MoveTemp(Chunk));
+	}
+}
+
+void FESGridCore::CollectFrontierPlacements(const FGridShape& Shape, const FIntRect* Anchors, bool bRanked,
+	TArray<FESGridPlacement>& OutPlacements) const
+{
+	// Every anchor that puts one of the shape cells on a frontier cell
+	TArray<FESGridPlacement> Candidates;
+	for (const int32 Index : Frontier)
+	{
+		const FIntPoint Point = Grid.ToPoint(Index);
+		for (int32 i = 0; i < GridDirectionCount; ++i)
+		{
+			for (const auto p : Shape.Rotations[i].Cells)
+			{
+				const FIntPoint Anchor = Point - p;
+				if (Anchors[i].Contains(Anchor))
+				{
+					FESGridPlacement& Candidate = Candidates.AddDefaulted_GetRef();
+					Candidate.X = Anchor.X;
+					Candidate.Y = Anchor.Y;
+					Candidate.Direction = static_cast<EGridDirection>(i);
+				}
+			}
+		}
+	}
+
+	// Same order as the row scan, then drop the duplicates of anchors reached from several frontier cells
+	Candidates.Sort([](const FESGridPlacement& A, const FESGridPlacement& B)
+	{
+		if (A.Y != B.Y) return A.Y < B.Y;
+		if (A.Direction != B.Direction) return A.Direction < B.Direction;
+		return A.X < B.X;
+	});
+	int32 NumUnique = 0;
+	for (int32 i = 0; i < Candidates.Num(); ++i)
+	{
+		if (NumUnique == 0 || Candidates[i].X != Candidates[NumUnique - 1].X || Candidates[i].Y != Candidates[NumUnique - 1].Y
+			|| Candidates[i].Direction != Candidates[NumUnique - 1].Direction)
+		{
+			Candidates[NumUnique++] = Candidates[i];
+		}
+	}
+	Candidates.SetNum(NumUnique, false);
+
+	TArray<bool> Valid;
+	Valid.SetNumZeroed(NumUnique);
+	RunParallel(NumUnique, [&](int32 i)
+	{
+		FESGridPlacement& Candidate = Candidates[i];
+		const FGridShapeRotation& Rotation = Shape.GetRotation(Candidate.Direction);
+		bool bOverlaps;
+		bool bTouches;
+		FESGridBitboard::TestShape(OccupiedBits, AdjacentBits, Candidate.X, Candidate.Y, Rotation, bOverlaps, bTouches);
+		Valid[i] = bTouches && !bOverlaps;
+		if (Valid[i] && bRanked)
+		{
+			Candidate.Score = FESGridBitboard::CountShape(AdjacentBits, Candidate.X, Candidate.Y, Rotation);
+		}
+	});
+
+	for (int32 i = 0; i < NumUnique; ++i)
+	{
+		if (Valid[i])
+		{
+			OutPlacements.Add(Candidates[i]);
+		}
+	}
+}
+
+FESGridSnapshotRef FESGridCore::TakeSnapshot()
+{
+	check(!IsEditing());
+
+	if (!bTrackSnapshotBlocks)
+	{
+		// First snapshot of this grid: every block holding ground, or touching it across a block edge
+		for (int32 i = 1; i < GroundTypeCount; ++i)
+		{
+			for (const int32 Index : OccupiedCells.Get(static_cast<EGroundType>(i)))
+			{
+				const FIntPoint Point = Grid.ToPoint(Index);
+				const FIntPoint Block(Point.X >> FESGridStorage::ChunkShift, Point.Y >> FESGridStorage::ChunkShift);
+				DirtyBlocks.Add(Block);
+				const int32 LocalX = Point.X & FESGridStorage::ChunkMask;
+				const int32 LocalY = Point.Y & FESGridStorage::ChunkMask;
+				if (LocalX == 0) DirtyBlocks.Add(Block - FIntPoint(1, 0));
+				if (LocalX == FESGridStorage::ChunkMask) DirtyBlocks.Add(Block + FIntPoint(1, 0));
+				if (LocalY == 0) DirtyBlocks.Add(Block - FIntPoint(0, 1));
+				if (LocalY == FESGridStorage::ChunkMask) DirtyBlocks.Add(Block + FIntPoint(0, 1));
+			}
+		}
+		bTrackSnapshotBlocks = true;
+	}
+
+	// Touched blocks get a fresh copy, older snapshots keep the block they already share
+	for (const FIntPoint& Block : DirtyBlocks)
+	{
+		const TSharedRef<FGridSnapshotBlock, ESPMode::ThreadSafe> Copy = MakeShared<FGridSnapshotBlock, ESPMode::ThreadSafe>();
+		uint64 AnyBits = 0;
+		for (int32 Row = 0; Row < FESGridStorage::ChunkSize; ++Row)
+		{
+			const int32 Y = Block.Y * FESGridStorage::ChunkSize + Row;
+			Copy->Occupied[Row] = OccupiedBits.GetWord(Block.X, Y);
+			Copy->Adjacent[Row] = AdjacentBits.GetWord(Block.X, Y);
+			AnyBits |= Copy->Occupied[Row] | Copy->Adjacent[Row];
+		}
+		if (AnyBits == 0)
+		{
+			SnapshotBlocks.Remove(Block);
+			continue;
+		}
+		Grid.ReadChunk(Block.X, Block.Y, Copy->Cells);
+		SnapshotBlocks.Add(Block, Copy);
+	}
+	DirtyBlocks.Reset();
+
+	const TSharedRef<FESGridSnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<FESGridSnapshot, ESPMode::ThreadSafe>();
+	Snapshot->Blocks = SnapshotBlocks;
+	Snapshot->Bounds = Grid.GetValidBounds();
+	Snapshot->EditVersion = EditVersion;
+	if (SnapshotBlocks.Num() > 0)
+	{
+		Snapshot->BlockBounds = FIntRect(MAX_int32, MAX_int32, MIN_int32, MIN_int32);
+		for (const auto& Pair : SnapshotBlocks)
+		{
+			Snapshot->BlockBounds.Include(Pair.Key * FESGridStorage::ChunkSize);
+			Snapshot->BlockBounds.Include((Pair.Key + FIntPoint(1, 1)) * FESGridStorage::ChunkSize);
+		}
+	}
+	return Snapshot;
+}
+
+bool FESGridCore::IsFrontierCell(int32 X, int32 Y) const
+{
+	const int32 Index = IsValid(X, Y) ? Grid.ToIndex(X, Y) : INDEX_NONE;
+	return Index != INDEX_NONE && Frontier.Contains(Index);
+}
+
+TArray<FIntPoint> FESGridCore::GetFrontierPoints() const
+{
+	TArray<FIntPoint> Result;
+	Result.Reserve(Frontier.Num());
+	for (const int32 Index : Frontier)
+	{
+		Result.Add(Grid.ToPoint(Index));
+	}
+	return Result;
+}
+
+int32 FESGridCore::GetNeighbourCount(int32 X, int32 Y) const
+{
+	const int32 Index = IsValid(X, Y) ? Grid.ToIndex(X, Y) : INDEX_NONE;
+	return Index != INDEX_NONE ? NeighbourCounts[Index] : 0;
+}
+
+EGroundType FESGridCore::WriteCell(int32 X, int32 Y, EGroundType Type)
+{
+	// Writing None into a chunk that was never allocated changes nothing
+	const int32 Index = Type != GroundTypeNone ? Grid.FindOrAddIndex(X, Y) : Grid.ToIndex(X, Y);
+	if (Index == INDEX_NONE)
+	{
+		return GroundTypeNone;
+	}
+	SyncTableCapacity();
+
+	const EGroundType OldType = Grid.GetAt(Index);
+	if (OldType == Type)
+	{
+		return OldType;
+	}
+
+	// Keep the chunk alive until every table is updated
+	Grid.Retain(Index);
+	Grid.SetAt(Index, Type);
+	RecordChange(X, Y, OldType, Type);
+	MarkSnapshotDirty(X, Y);
+
+	if (OldType != GroundTypeNone)
+	{
+		OccupiedCells.Remove(OldType, Index);
+	}
+	if (Type != GroundTypeNone)
+	{
+		OccupiedCells.Add(Type, Index);
+	}
+	AreaCounts.Write(X, Y, OldType, Type);
+
+	const bool bOccupied = Type != GroundTypeNone;
+	if ((OldType != GroundTypeNone) != bOccupied)
+	{
+		OccupiedBits.Set(X, Y, bOccupied);
+
+		// The cell itself enters or leaves the frontier
+		if (bOccupied)
+		{
+			Frontier.Remove(Index);
+		}
+		else if (NeighbourCounts[Index] > 0)
+		{
+			Frontier.Add(Index);
+		}
+
+		const int32 Delta = bOccupied ? 1 : -1;
+		AdjustNeighbourCount(X + 1, Y, Delta);
+		AdjustNeighbourCount(X - 1, Y, Delta);
+		AdjustNeighbourCount(X, Y + 1, Delta);
+		AdjustNeighbourCount(X, Y - 1, Delta);
+	}
+
+	Grid.Release(Index);
+	return OldType;
+}
+
+void FESGridCore::AdjustNeighbourCount(int32 X, int32 Y, int32 Delta)
+{
+	if (!IsValid(X, Y)) return;
+
+	// A cell touching ground keeps its chunk alive, so decrements always find it
+	const int32 Index = Delta > 0 ? Grid.FindOrAddIndex(X, Y) : Grid.ToIndex(X, Y);
+	check(Index != INDEX_NONE);
+	SyncTableCapacity();
+
+	uint8& Count = NeighbourCounts[Index];
+	const bool bWasTouching = Count > 0;
+	Count += Delta;
+	const bool bTouching = Count > 0;
+	if (bWasTouching == bTouching)
+	{
+		return;
+	}
+
+	if (bTouching)
+	{
+		Grid.Retain(Index);
+	}
+	AdjacentBits.Set(X, Y, bTouching);
+	MarkSnapshotDirty(X, Y);
+
+	if (Grid.GetAt(Index) == GroundTypeNone)
+	{
+		if (bTouching)
+		{
+			Frontier.Add(Index);
+		}
+		else
+		{
+			Frontier.Remove(Index);
+		}
+	}
+
+	if (!bTouching)
+	{
+		Grid.Release(Index);
+	}
+}
+
+void FESGridCore::SyncTableCapacity()
+{
+	const int32 Capacity = Grid.GetCapacity();
+	if (NeighbourCounts.Num() >= Capacity)
+	{
+		return;
+	}
+
+	NeighbourCounts.AddZeroed(Capacity - NeighbourCounts.Num());
+	Frontier.Grow(Capacity);
+	OccupiedCells.Grow(Capacity);
+	OccupiedBits.SyncCapacity();
+	AdjacentBits.SyncCapacity();
+}
+
+void FESGridCore::MarkEdited(const FIntRect& Rect)
+{
+	++EditVersion;
+	LastEditRect = Rect;
+}
+
+bool FESGridCore::CommitEdit(FGridEditBatch& OutBatch)
+{
+	check(EditDepth > 0);
+	if (--EditDepth > 0)
+	{
+		return false;
+	}
+
+	// Drop cells that ended up with their original type
+	FGridEditBatch Batch = MoveTemp(PendingBatch);
+	PendingBatch = FGridEditBatch();
+	PendingChangeIndex.Reset();
+	Batch.Changes.RemoveAll([](const FGridCellChange& Change)
+	{
+		return Change.OldType == Change.NewType;
+	});
+	if (Batch.Changes.Num() == 0)
+	{
+		return false;
+	}
+
+	FIntPoint Min = FIntPoint(Batch.Changes[0].X, Batch.Changes[0].Y);
+	FIntPoint Max = Min;
+	for (const FGridCellChange& Change : Batch.Changes)
+	{
+		Min = Min.ComponentMin(FIntPoint(Change.X, Change.Y));
+		Max = Max.ComponentMax(FIntPoint(Change.X, Change.Y));
+	}
+	Batch.DirtyRect = FIntRect(Min, Max + FIntPoint(1, 1));
+
+	MarkEdited(Batch.DirtyRect);
+	OutBatch = MoveTemp(Batch);
+	return true;
+}
+
+void FESGridCore::RecordChange(int32 X, int32 Y, EGroundType OldType, EGroundType NewType)
+{
+	if (EditDepth == 0)
+	{
+		MarkEdited(FIntRect(X, Y, X + 1, Y + 1));
+		return;
+	}
+
+	const FIntPoint Point(X, Y);
+	if (const int32* Existing = PendingChangeIndex.Find(Point))
+	{
+		PendingBatch.Changes[*Existing].NewType = NewType;
+		return;
+	}
+
+	FGridCellChange& Change = PendingBatch.Changes.AddDefaulted_GetRef();
+	Change.X = X;
+	Change.Y = Y;
+	Change.OldType = OldType;
+	Change.NewType = NewType;
+	PendingChangeIndex.Add(Point, PendingBatch.Changes.Num() - 1);
+}
@@ -0,0 +1,292 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Grid/ESGridCoreTypes.h"
+#include "Core/Grid/ESGridStorage.h"
+#include "Core/Grid/ESGridShapeLibrary.h"
+#include "Core/Grid/ESGridBitboard.h"
+#include "Core/Grid/ESGridCellSet.h"
+#include "Core/Grid/ESGridSnapshot.h"
+#include "Core/Grid/ESGridAreaCounts.h"
+
+// Mirrored for Blueprint by FGridPlacement
+struct FESGridPlacement
+{
+	int32 X = 0;
+
+	int32 Y = 0;
+
+	EGridDirection Direction = GridDirectionNorth;
+
+	// Shape cells touching existing ground, only filled by ranked queries
+	int32 Score = 0;
+};
+
+/**
+ * Valid placements of one shape, kept current with FESGridCore::UpdatePlacementSet.
+ */
+struct FESGridPlacementSet
+{
+	FESGridShapeHandle Shape;
+
+	TArray<FESGridPlacement> Placements;
+
+	// Grid edit version the placements were computed at
+	int32 Version = INDEX_NONE;
+};
+
+struct FGridCellChange
+{
+	int32 X = 0;
+
+	int32 Y = 0;
+
+	EGroundType OldType = GroundTypeNone;
+
+	EGroundType NewType = GroundTypeNone;
+};
+
+/**
+ * Net cell changes of one committed edit, each cell appears once.
+ */
+struct FGridEditBatch
+{
+	TArray<FGridCellChange> Changes;
+
+	// Bounds of the changed cells, max exclusive
+	FIntRect DirtyRect;
+};
+
+/**
+ * Grid storage, occupancy tables and placement logic without any UObject, world or event.
+ * Only needs the Core module: UESGridSystem wraps one for gameplay, the benchmark program owns one directly.
+ * Writes made outside a transaction count as one edit each.
+ */
+class EVEOFTHESTORM_API FESGridCore
+{
+public:
+	FESGridCore() = default;
+
+	// The bitboards point at the storage of their owner
+	FESGridCore(const FESGridCore&) = delete;
+
+	FESGridCore& operator=(const FESGridCore&) = delete;
+
+	void Initialize(int32 Width, int32 Height, EESGridStorageLayout Layout = EESGridStorageLayout::RowMajor,
+	                EESGridBoundsMode Bounds = EESGridBoundsMode::Fixed);
+
+	FORCEINLINE bool IsValid(int32 X, int32 Y) const { return Grid.IsValid(X, Y); }
+
+	FORCEINLINE EGroundType Get(int32 X, int32 Y) const { return Grid.Get(X, Y); }
+
+	// THREADING
+
+	/**
+	 * Spread placement searches and snapshot copies over worker threads.
+	 * Without one every loop runs on the calling thread.
+	 */
+	void SetParallelFor(FESGridParallelFor InParallelFor) { ParallelForFunc = MoveTemp(InParallelFor); }
+
+	// Body(i) for every i in [0, Num), through the parallel-for when there is one
+	void RunParallel(int32 Num, TFunctionRef<void(int32)> Body) const;
+
+	// SHAPES
+
+	FESGridShapeHandle RegisterShape(const TArray<FIntPoint>& Shape) { return ShapeLibrary.Register(Shape); }
+
+	// See FESGridShapeLibrary::SetRotator
+	void SetShapeRotator(FESGridShapeRotator Rotator) { ShapeLibrary.SetRotator(MoveTemp(Rotator)); }
+
+	// Find the interned shape, registering it on first use
+	FESGridShapeHandle ResolveShape(const TArray<FIntPoint>& Shape) const;
+
+	const FESGridShapeLibrary& GetShapeLibrary() const { return ShapeLibrary; }
+
+	// True when the footprint overlaps ground or touches none
+	bool HasShape(int32 X, int32 Y, FESGridShapeHandle Shape, EGridDirection Direction) const;
+
+	// True when the footprint is inside the grid and touches ground, overlaps are allowed
+	bool CanPlaceShape(int32 X, int32 Y, FESGridShapeHandle Shape, EGridDirection Direction) const;
+
+	bool PlaceShape(int32 X, int32 Y, FESGridShapeHandle Shape, EGroundType Type, EGridDirection Direction);
+
+	void RemoveShape(int32 X, int32 Y, FESGridShapeHandle Shape, EGridDirection Direction);
+
+	void UpdateShape(int32 X, int32 Y, FESGridShapeHandle Shape, EGroundType Type, EGridDirection Direction);
+
+	// Write every footprint cell inside the grid, without any placement rule
+	void SetShape(int32 X, int32 Y, const FGridShapeRotation& Shape, EGroundType Type);
+
+	// Write one valid cell and keep every table in sync, returns the previous type
+	EGroundType WriteCell(int32 X, int32 Y, EGroundType Type);
+
+	bool IsPointNearGround(int32 X, int32 Y) const { return AdjacentBits.Get(X, Y); }
+
+	// Every footprint cell is ground, of InGroundType unless it is None
+	bool IsGroundValid(int32 X, int32 Y, const TArray<FIntPoint>& Shape, EGroundType InGroundType) const;
+
+	// PLACEMENT QUERIES
+
+	TArray<FESGridPlacement> FindShapePlacements(FESGridShapeHandle Shape, const FIntRect* Region = nullptr,
+	                                           bool bRanked = false, int32 MaxResults = 0) const;
+
+	// Bring the set up to date, only rechecking anchors around the last edit when possible
+	void UpdatePlacementSet(FESGridPlacementSet& Set) const;
+
+	// OCCUPIED CELLS
+
+	TArray<FIntPoint> GetPointsOfType(EGroundType Type, int32 Count = 0) const;
+
+	int32 GetOccupiedCount(EGroundType Type = GroundTypeNone) const;
+
+	bool GetRandomPoint(const FRandomStream& Stream, FIntPoint& OutPoint, EGroundType Type = GroundTypeNone) const;
+
+	// Cells of one non-empty type, as storage indices
+	const TArray<int32>& GetOccupiedCells(EGroundType Type) const { return OccupiedCells.Get(Type); }
+
+	// AREA COUNTS
+
+	// Cells of Type in Rect (max exclusive), None counts every non-empty cell
+	int32 CountInRect(EGroundType Type, const FIntRect& Rect) const { return AreaCounts.Count(Type, Rect); }
+
+	const FESGridAreaCounts& GetAreaCounts() const { return AreaCounts; }
+
+	// FRONTIER
+
+	// Empty cells with at least one non-empty 4-neighbour, as storage indices
+	const FESGridCellSet& GetFrontier() const { return Frontier; }
+
+	bool IsFrontierCell(int32 X, int32 Y) const;
+
+	TArray<FIntPoint> GetFrontierPoints() const;
+
+	// Non-empty 4-neighbours of a cell, 0 outside the grid
+	int32 GetNeighbourCount(int32 X, int32 Y) const;
+
+	// EDIT TRANSACTIONS
+
+	// Transactions nest, changes are merged until the outermost one commits
+	void BeginEdit() { ++EditDepth; }
+
+	// True when the outermost transaction committed changes, they are moved to OutBatch
+	bool CommitEdit(FGridEditBatch& OutBatch);
+
+	bool IsEditing() const { return EditDepth > 0; }
+
+	// Incremented by every edit
+	int32 GetEditVersion() const { return EditVersion; }
+
+	// Cells touched by the last edit, max exclusive
+	const FIntRect& GetLastEditRect() const { return LastEditRect; }
+
+	// SNAPSHOTS
+
+	/**
+	 * Immutable copy of the grid for worker threads, call on the owning thread outside transactions.
+	 * Only blocks edited since the previous snapshot are copied, the others are shared with it.
+	 */
+	FESGridSnapshotRef TakeSnapshot();
+
+	// SERIALIZATION
+
+	/**
+	 * Compact binary form: only 64x64 blocks holding ground are written, each one run-length encoded
+	 * or nibble-packed, whichever is smaller. The save size follows the built area, not the grid size.
+	 */
+	void Save(FArchive& Ar) const;
+
+	/**
+	 * Replace the whole grid, blocks are decoded as they are read. No change is recorded and every table is rebuilt once.
+	 * Returns false on a bad or truncated archive, the grid is then left empty unless the header was already rejected.
+	 * Headers are rejected when FESGridStorage::IsSupported refuses the size, layout and bounds.
+	 */
+	bool Load(FArchive& Ar);
+
+	/**
+	 * Replace the whole grid with generated cells of Rect (max exclusive, row by row), keeping the size and layout.
+	 * Goes through the same block path as Load, so no change is recorded.
+	 */
+	void BuildFromCells(const FIntRect& Rect, const EGroundType* Cells);
+
+	const FESGridStorage& GetStorage() const { return Grid; }
+
+	// Bit set for every non-empty cell
+	const FESGridBitboard& GetOccupiedBits() const { return OccupiedBits; }
+
+	// Bit set for every cell with at least one non-empty 4-neighbour
+	const FESGridBitboard& GetAdjacentBits() const { return AdjacentBits; }
+
+protected:
+	void AdjustNeighbourCount(int32 X, int32 Y, int32 Delta);
+
+	// Grow the per-cell tables after the chunked storage added chunks
+	void SyncTableCapacity();
+
+	// Record an edit touching the cells in Rect (max exclusive)
+	void MarkEdited(const FIntRect& Rect);
+
+	// Merge a cell change into the open transaction
+	void RecordChange(int32 X, int32 Y, EGroundType OldType, EGroundType NewType);
+
+	// Write the non-empty cells of one decoded block straight into the storage, occupied tables included
+	void LoadBlock(int32 BlockX, int32 BlockY, const EGroundType* Cells);
+
+	// Neighbour counts, adjacency and frontier of the loaded blocks and the ring around them
+	void RebuildAdjacency(const TArray<FIntPoint>& Blocks);
+
+	FORCEINLINE void MarkSnapshotDirty(int32 X, int32 Y)
+	{
+		if (bTrackSnapshotBlocks)
+		{
+			DirtyBlocks.Add(FIntPoint(X >> FESGridStorage::ChunkShift, Y >> FESGridStorage::ChunkShift));
+		}
+	}
+
+	// Regions holds one optional anchor region per direction
+	void CollectPlacements(const FGridShape& Shape, const FIntRect* const* Regions, bool bRanked,
+	                       TArray<FESGridPlacement>& OutPlacements) const;
+
+	// Candidate anchors generated from the frontier instead of scanning every row
+	void CollectFrontierPlacements(const FGridShape& Shape, const FIntRect* Anchors, bool bRanked,
+	                               TArray<FESGridPlacement>& OutPlacements) const;
+
+	FESGridStorage Grid;
+
+	FESGridBitboard OccupiedBits;
+
+	FESGridBitboard AdjacentBits;
+
+	// Indexed like the storage, cells touching ground keep their chunk alive
+	TArray<uint8> NeighbourCounts;
+
+	FESGridCellSet Frontier;
+
+	FESGridTypedCellSets OccupiedCells;
+
+	FESGridAreaCounts AreaCounts;
+
+	int32 EditVersion = 0;
+
+	FIntRect LastEditRect;
+
+	// Interned lazily from const queries, only touched on the game thread
+	mutable FESGridShapeLibrary ShapeLibrary;
+
+	FESGridParallelFor ParallelForFunc;
+
+	int32 EditDepth = 0;
+
+	FGridEditBatch PendingBatch;
+
+	// Position of each cell in PendingBatch.Changes
+	TMap<FIntPoint, int32> PendingChangeIndex;
+
+	// Blocks published by the last snapshot, edits only mark blocks dirty once a snapshot was taken
+	TMap<FIntPoint, FESGridSnapshot::FBlockRef> SnapshotBlocks;
+
+	TSet<FIntPoint> DirtyBlocks;
+
+	bool bTrackSnapshotBlocks = false;
+};
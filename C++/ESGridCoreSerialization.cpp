@@ -0,0 +1,393 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridCoreSerialization.cpp#
+ * Author: Yuyang Qiu
+ * Function:Block-sparse binary save format of the grid core.
+ */
+
+#include "Core/Grid/ESGridCore.h"
+
+#include "Serialization/Archive.h"
+
+// 'ESGD'
+static constexpr uint32 GridFileMagic = 0x44475345;
+static constexpr uint32 GridFileVersion = 1;
+
+// Blocks line up with storage chunks and bitboard words
+static constexpr int32 BlockShift = FESGridStorage::ChunkShift;
+static constexpr int32 BlockSize = FESGridStorage::ChunkSize;
+static constexpr int32 BlockArea = FESGridStorage::ChunkArea;
+
+static_assert(GroundTypeCount <= 16, "Ground types are stored in nibbles");
+
+enum class EGridBlockEncoding : uint8
+{
+	// Two cells per byte, first cell in the low nibble
+	Nibbles,
+	// One byte per run: type in the low nibble, length - 1 in the high one. 15 means the length - 16 follows as uint16
+	Runs
+};
+
+// The cells of a block row follow each other in storage
+static bool IsRowContiguous(const FESGridStorage& Grid, int32 BaseX, int32 Y)
+{
+	return Grid.GetLayout() != EESGridStorageLayout::Tiled && Grid.IsValid(BaseX, Y) && Grid.IsValid(BaseX + BlockSize - 1, Y);
+}
+
+static void EncodeNibbles(const EGroundType* Cells, TArray<uint8>& Out)
+{
+	Out.SetNumUninitialized(BlockArea / 2);
+	for (int32 i = 0; i < BlockArea / 2; ++i)
+	{
+		Out[i] = static_cast<uint8>(static_cast<uint8>(Cells[i * 2]) | static_cast<uint8>(Cells[i * 2 + 1]) << 4);
+	}
+}
+
+static void EncodeRuns(const EGroundType* Cells, TArray<uint8>& Out)
+{
+	int32 Cell = 0;
+	while (Cell < BlockArea)
+	{
+		const EGroundType Type = Cells[Cell];
+		int32 Length = 1;
+		while (Cell + Length < BlockArea && Cells[Cell + Length] == Type)
+		{
+			++Length;
+		}
+
+		const uint8 TypeBits = static_cast<uint8>(Type);
+		if (Length < 16)
+		{
+			Out.Add(static_cast<uint8>(TypeBits | (Length - 1) << 4));
+		}
+		else
+		{
+			const uint16 Extra = Length - 16;
+			Out.Add(static_cast<uint8>(TypeBits | 0xF0));
+			Out.Add(static_cast<uint8>(Extra & 0xFF));
+			Out.Add(static_cast<uint8>(Extra >> 8));
+		}
+		Cell += Length;
+	}
+}
+
+static bool DecodeBlock(uint8 Encoding, const TArray<uint8>& Payload, EGroundType* Cells)
+{
+	if (Encoding == static_cast<uint8>(EGridBlockEncoding::Nibbles))
+	{
+		if (Payload.Num() != BlockArea / 2)
+		{
+			return false;
+		}
+		for (int32 i = 0; i < BlockArea / 2; ++i)
+		{
+			const uint8 Low = Payload[i] & 0x0F;
+			const uint8 High = Payload[i] >> 4;
+			if (Low >= GroundTypeCount || High >= GroundTypeCount)
+			{
+				return false;
+			}
+			Cells[i * 2] = static_cast<EGroundType>(Low);
+			Cells[i * 2 + 1] = static_cast<EGroundType>(High);
+		}
+		return true;
+	}
+
+	if (Encoding != static_cast<uint8>(EGridBlockEncoding::Runs))
+	{
+		return false;
+	}
+
+	int32 Cell = 0;
+	for (int32 Byte = 0; Byte < Payload.Num(); ++Byte)
+	{
+		const uint8 Type = Payload[Byte] & 0x0F;
+		int32 Length = (Payload[Byte] >> 4) + 1;
+		if (Length == 16)
+		{
+			if (Byte + 2 >= Payload.Num())
+			{
+				return false;
+			}
+			Length += Payload[Byte + 1] | Payload[Byte + 2] << 8;
+			Byte += 2;
+		}
+		if (Type >= GroundTypeCount || Cell + Length > BlockArea)
+		{
+			return false;
+		}
+		for (const int32 End = Cell + Length; Cell < End; ++Cell)
+		{
+			Cells[Cell] = static_cast<EGroundType>(Type);
+		}
+	}
+	return Cell == BlockArea;
+}
+
+void FESGridCore::Save(FArchive& Ar) const
+{
+	check(Ar.IsSaving());
+
+	// Only blocks holding ground are written, in row order
+	TSet<FIntPoint> BlockSet;
+	for (int32 i = 1; i < GroundTypeCount; ++i)
+	{
+		for (const int32 Index : OccupiedCells.Get(static_cast<EGroundType>(i)))
+		{
+			const FIntPoint Point = Grid.ToPoint(Index);
+			BlockSet.Add(FIntPoint(Point.X >> BlockShift, Point.Y >> BlockShift));
+		}
+	}
+	TArray<FIntPoint> Blocks = BlockSet.Array();
+	Blocks.Sort([](const FIntPoint& A, const FIntPoint& B)
+	{
+		return A.Y != B.Y ? A.Y < B.Y : A.X < B.X;
+	});
+
+	uint32 Magic = GridFileMagic;
+	uint32 Version = GridFileVersion;
+	int32 Width = Grid.GetWidth();
+	int32 Height = Grid.GetHeight();
+	uint8 Layout = static_cast<uint8>(Grid.GetLayout());
+	uint8 Bounds = static_cast<uint8>(Grid.GetBoundsMode());
+	int32 NumBlocks = Blocks.Num();
+	Ar << Magic << Version << Width << Height << Layout << Bounds << NumBlocks;
+
+	EGroundType Cells[BlockArea];
+	TArray<uint8> Payload;
+	for (FIntPoint Block : Blocks)
+	{
+		Grid.ReadChunk(Block.X, Block.Y, Cells);
+
+		Payload.Reset();
+		EncodeRuns(Cells, Payload);
+		uint8 Encoding = static_cast<uint8>(EGridBlockEncoding::Runs);
+		if (Payload.Num() >= BlockArea / 2)
+		{
+			EncodeNibbles(Cells, Payload);
+			Encoding = static_cast<uint8>(EGridBlockEncoding::Nibbles);
+		}
+
+		uint32 PayloadSize = Payload.Num();
+		Ar << Block.X << Block.Y << Encoding << PayloadSize;
+		Ar.Serialize(Payload.GetData(), PayloadSize);
+	}
+}
+
+bool FESGridCore::Load(FArchive& Ar)
+{
+	check(Ar.IsLoading());
+	check(!IsEditing());
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Ar << Magic << Version;
+	if (Ar.IsError() || Magic != GridFileMagic || Version == 0 || Version > GridFileVersion)
+	{
+		return false;
+	}
+
+	int32 Width = 0;
+	int32 Height = 0;
+	uint8 Layout = 0;
+	uint8 Bounds = 0;
+	int32 NumBlocks = 0;
+	Ar << Width << Height << Layout << Bounds << NumBlocks;
+	if (Ar.IsError() || NumBlocks < 0
+		|| Layout > static_cast<uint8>(EESGridStorageLayout::Chunked) || Bounds > static_cast<uint8>(EESGridBoundsMode::Unbounded))
+	{
+		return false;
+	}
+
+	// Rejected before anything is allocated, the current grid is kept
+	const EESGridStorageLayout GridLayout = static_cast<EESGridStorageLayout>(Layout);
+	const EESGridBoundsMode GridBounds = static_cast<EESGridBoundsMode>(Bounds);
+	if (!FESGridStorage::IsSupported(Width, Height, GridLayout, GridBounds))
+	{
+		return false;
+	}
+	Initialize(Width, Height, GridLayout, GridBounds);
+
+	const FIntRect Valid = Grid.GetValidBounds();
+	const FIntRect ValidBlocks(Valid.Min.X >> BlockShift, Valid.Min.Y >> BlockShift,
+	                           ((Valid.Max.X - 1) >> BlockShift) + 1, ((Valid.Max.Y - 1) >> BlockShift) + 1);
+
+	TArray<FIntPoint> Blocks;
+	TArray<uint8> Payload;
+	EGroundType Cells[BlockArea];
+	FIntRect Loaded(MAX_int32, MAX_int32, MIN_int32, MIN_int32);
+	for (int32 i = 0; i < NumBlocks; ++i)
+	{
+		FIntPoint Block;
+		uint8 Encoding = 0;
+		uint32 PayloadSize = 0;
+		Ar << Block.X << Block.Y << Encoding << PayloadSize;
+
+		// Neither encoding needs more than one byte per cell
+		bool bValid = !Ar.IsError() && PayloadSize <= BlockArea && ValidBlocks.Contains(Block);
+		if (bValid)
+		{
+			Payload.SetNumUninitialized(PayloadSize);
+			Ar.Serialize(Payload.GetData(), PayloadSize);
+			bValid = !Ar.IsError() && DecodeBlock(Encoding, Payload, Cells);
+		}
+		if (!bValid)
+		{
+			Initialize(Width, Height, GridLayout, GridBounds);
+			return false;
+		}
+
+		LoadBlock(Block.X, Block.Y, Cells);
+		Blocks.Add(Block);
+		Loaded.Include(Block * BlockSize);
+		Loaded.Include((Block + FIntPoint(1, 1)) * BlockSize);
+	}
+
+	RebuildAdjacency(Blocks);
+
+	// Initialize counted as one edit already, so placement sets older than the load are rebuilt in full
+	MarkEdited(Blocks.Num() > 0 ? Loaded : FIntRect());
+	return true;
+}
+
+void FESGridCore::BuildFromCells(const FIntRect& Rect, const EGroundType* Cells)
+{
+	check(!IsEditing());
+
+	Initialize(Grid.GetWidth(), Grid.GetHeight(), Grid.GetLayout(), Grid.GetBoundsMode());
+	if (Rect.Area() <= 0)
+	{
+		return;
+	}
+
+	const FIntRect RectBlocks(Rect.Min.X >> BlockShift, Rect.Min.Y >> BlockShift,
+	                          ((Rect.Max.X - 1) >> BlockShift) + 1, ((Rect.Max.Y - 1) >> BlockShift) + 1);
+	const int32 Width = Rect.Width();
+
+	TArray<FIntPoint> Blocks;
+	EGroundType Block[BlockArea];
+	FIntRect Loaded(MAX_int32, MAX_int32, MIN_int32, MIN_int32);
+	for (int32 BlockY = RectBlocks.Min.Y; BlockY < RectBlocks.Max.Y; ++BlockY)
+	{
+		for (int32 BlockX = RectBlocks.Min.X; BlockX < RectBlocks.Max.X; ++BlockX)
+		{
+			// Cells of the block outside Rect stay empty
+			bool bEmpty = true;
+			for (int32 Row = 0; Row < BlockSize; ++Row)
+			{
+				const int32 Y = BlockY * BlockSize + Row;
+				for (int32 Column = 0; Column < BlockSize; ++Column)
+				{
+					const int32 X = BlockX * BlockSize + Column;
+					const EGroundType Type = Rect.Contains(FIntPoint(X, Y))
+						? Cells[(Y - Rect.Min.Y) * Width + X - Rect.Min.X]
+						: GroundTypeNone;
+					Block[Row * BlockSize + Column] = Type;
+					bEmpty &= Type == GroundTypeNone;
+				}
+			}
+			if (bEmpty)
+			{
+				continue;
+			}
+
+			const FIntPoint BlockPos(BlockX, BlockY);
+			LoadBlock(BlockX, BlockY, Block);
+			Blocks.Add(BlockPos);
+			Loaded.Include(BlockPos * BlockSize);
+			Loaded.Include((BlockPos + FIntPoint(1, 1)) * BlockSize);
+		}
+	}
+
+	RebuildAdjacency(Blocks);
+	MarkEdited(Blocks.Num() > 0 ? Loaded : FIntRect());
+}
+
+void FESGridCore::LoadBlock(int32 BlockX, int32 BlockY, const EGroundType* Cells)
+{
+	const int32 BaseX = BlockX * BlockSize;
+	const int32 BaseY = BlockY * BlockSize;
+	for (int32 Row = 0; Row < BlockSize; ++Row, Cells += BlockSize)
+	{
+		const int32 Y = BaseY + Row;
+		uint64 Mask = 0;
+		for (int32 X = 0; X < BlockSize; ++X)
+		{
+			if (Cells[X] != GroundTypeNone && Grid.IsValid(BaseX + X, Y))
+			{
+				Mask |= uint64(1) << X;
+			}
+		}
+		if (Mask == 0)
+		{
+			continue;
+		}
+
+		const bool bContiguous = IsRowContiguous(Grid, BaseX, Y);
+		const int32 RowIndex = bContiguous ? Grid.FindOrAddIndex(BaseX, Y) : INDEX_NONE;
+		SyncTableCapacity();
+		for (uint64 Bits = Mask; Bits != 0; Bits &= Bits - 1)
+		{
+			const int32 X = FMath::CountTrailingZeros64(Bits);
+			const int32 Index = bContiguous ? RowIndex + X : Grid.FindOrAddIndex(BaseX + X, Y);
+			SyncTableCapacity();
+
+			const EGroundType OldType = Grid.GetAt(Index);
+			if (OldType != GroundTypeNone)
+			{
+				OccupiedCells.Remove(OldType, Index);
+			}
+			Grid.SetAt(Index, Cells[X]);
+			OccupiedCells.Add(Cells[X], Index);
+			AreaCounts.Write(BaseX + X, Y, OldType, Cells[X]);
+		}
+
+		// A block row is exactly one bitboard word
+		OccupiedBits.OrWord(BlockX, Y, Mask);
+	}
+}
+
+void FESGridCore::RebuildAdjacency(const TArray<FIntPoint>& Blocks)
+{
+	// Counts are assigned, not added, so cells on the ring shared by two blocks can be visited twice
+	for (const FIntPoint& Block : Blocks)
+	{
+		const int32 BaseY = Block.Y * BlockSize;
+		for (int32 Y = BaseY - 1; Y <= BaseY + BlockSize; ++Y)
+		{
+			// The block column and the single cell on each side of it
+			for (int32 WordX = Block.X - 1; WordX <= Block.X + 1; ++WordX)
+			{
+				const uint64 Column = WordX == Block.X ? ~uint64(0) : WordX < Block.X ? uint64(1) << 63 : uint64(1);
+				const int32 BaseX = WordX * 64;
+				const uint64 Up = OccupiedBits.GetWord(WordX, Y - 1);
+				const uint64 Down = OccupiedBits.GetWord(WordX, Y + 1);
+				const uint64 Left = OccupiedBits.GetBits(BaseX - 1, Y);
+				const uint64 Right = OccupiedBits.GetBits(BaseX + 1, Y);
+
+				for (uint64 Bits = (Up | Down | Left | Right) & Column; Bits != 0; Bits &= Bits - 1)
+				{
+					const int32 Bit = FMath::CountTrailingZeros64(Bits);
+					const int32 X = BaseX + Bit;
+					if (!Grid.IsValid(X, Y)) continue;
+
+					const int32 Index = Grid.FindOrAddIndex(X, Y);
+					SyncTableCapacity();
+
+					uint8& Count = NeighbourCounts[Index];
+					if (Count == 0)
+					{
+						Grid.Retain(Index);
+						AdjacentBits.Set(X, Y, true);
+						if (Grid.GetAt(Index) == GroundTypeNone)
+						{
+							Frontier.Add(Index);
+						}
+					}
+					Count = ((Up >> Bit) & 1) + ((Down >> Bit) & 1) + ((Left >> Bit) & 1) + ((Right >> Bit) & 1);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Engine enums the grid core works with, declared without their reflection so the core builds without UHT.
+ * EGroundType is defined in Core/Types/GroundType.h, EGridDirection in Core/Grid/ESGridType.h.
+ */
+enum class EGroundType : uint8;
+
+// North, East, South, West
+enum class EGridDirection : uint8;
+
+/**
+ * EGroundType values, None included. Sizes the per-type cell sets, area counts and type masks,
+ * UESGridSystem checks it against the reflected enum on construction.
+ */
+static constexpr int32 GroundTypeCount = 6;
+
+static_assert(GroundTypeCount <= 32, "Ground type masks are uint32");
+
+// EGroundType::None
+static constexpr EGroundType GroundTypeNone = static_cast<EGroundType>(0);
+
+static constexpr int32 GridDirectionCount = 4;
+
+static constexpr EGridDirection GridDirectionNorth = static_cast<EGridDirection>(0);
+
+// Calls Body(i) for every i in [0, Num), possibly from several threads at once, and returns when all are done
+using FESGridParallelFor = TFunction<void(int32 Num, TFunctionRef<void(int32)> Body)>;
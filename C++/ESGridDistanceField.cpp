@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridDistanceField.cpp#
+ * Author: Yuyang Qiu
+ * Function:Capped distance fields over the grid, updated around edits.
+ */
+
+#include "Core/Grid/ESGridDistanceField.h"
+
+#include "Core/Grid/ESGridCore.h"
+
+void FESGridDistanceField::Initialize(const FESGridCore* InCore, const FIntRect& InBounds, uint32 InSourceMask,
+                                      int32 InMaxDistance)
+{
+	Core = InCore;
+	Bounds = InBounds;
+	SourceMask = InSourceMask;
+	MaxDistance = FMath::Clamp(InMaxDistance, 1, static_cast<int32>(MAX_uint16));
+
+	Distances.Reset();
+	Distances.SetNumUninitialized(FMath::Max(Bounds.Area(), 0));
+	Rebuild(true);
+}
+
+void FESGridDistanceField::Rebuild(bool bParallel)
+{
+	if (Core && Bounds.Area() > 0)
+	{
+		ComputeRegion(Bounds, Bounds, bParallel);
+	}
+}
+
+void FESGridDistanceField::Update(const FGridEditBatch& Batch)
+{
+	if (!Core || Batch.DirtyRect.Area() <= 0)
+	{
+		return;
+	}
+
+	// Only cells within the cap of a changed cell can change, and only sources within the cap of those matter
+	FIntRect Output = Batch.DirtyRect;
+	Output.InflateRect(MaxDistance);
+	Output.Clip(Bounds);
+	if (Output.Area() <= 0)
+	{
+		return;
+	}
+	if (Output.Area() * 4 > Bounds.Area())
+	{
+		Rebuild(true);
+		return;
+	}
+
+	FIntRect Input = Output;
+	Input.InflateRect(MaxDistance);
+	Input.Clip(Bounds);
+	ComputeRegion(Input, Output, false);
+}
+
+void FESGridDistanceField::ComputeRegion(const FIntRect& Input, const FIntRect& Output, bool bParallel)
+{
+	const int32 Width = Input.Width();
+	const int32 Height = Input.Height();
+	const uint16 Cap = static_cast<uint16>(MaxDistance);
+	Scratch.SetNumUninitialized(Width * Height, false);
+	const auto ForEach = [this, bParallel](int32 Num, TFunctionRef<void(int32)> Body)
+	{
+		if (bParallel)
+		{
+			Core->RunParallel(Num, Body);
+			return;
+		}
+		for (int32 i = 0; i < Num; ++i)
+		{
+			Body(i);
+		}
+	};
+
+	// L1 distance is separable: nearest source along each row first, then along each column.
+	// Neighbour + 1 is taken in int32 and only narrowed after the min, it reaches 65536 at the uint16 cap
+	ForEach(Height, [this, &Input, Width, Cap](int32 Row)
+	{
+		uint16* Values = Scratch.GetData() + Row * Width;
+		const int32 Y = Input.Min.Y + Row;
+		uint16 Last = Cap;
+		for (int32 i = 0; i < Width; ++i)
+		{
+			const bool bSource = (SourceMask & (1u << static_cast<uint32>(Core->Get(Input.Min.X + i, Y)))) != 0;
+			Last = bSource ? 0 : static_cast<uint16>(FMath::Min<int32>(Last + 1, Cap));
+			Values[i] = Last;
+		}
+		for (int32 i = Width - 2; i >= 0; --i)
+		{
+			Values[i] = static_cast<uint16>(FMath::Min<int32>(Values[i], Values[i + 1] + 1));
+		}
+	});
+
+	ForEach(Width, [this, Width, Height](int32 Column)
+	{
+		uint16* Values = Scratch.GetData() + Column;
+		for (int32 i = 1; i < Height; ++i)
+		{
+			Values[i * Width] = static_cast<uint16>(FMath::Min<int32>(Values[i * Width], Values[(i - 1) * Width] + 1));
+		}
+		for (int32 i = Height - 2; i >= 0; --i)
+		{
+			Values[i * Width] = static_cast<uint16>(FMath::Min<int32>(Values[i * Width], Values[(i + 1) * Width] + 1));
+		}
+	});
+
+	const int32 FieldWidth = Bounds.Width();
+	for (int32 Y = Output.Min.Y; Y < Output.Max.Y; ++Y)
+	{
+		FMemory::Memcpy(Distances.GetData() + (Y - Bounds.Min.Y) * FieldWidth + Output.Min.X - Bounds.Min.X,
+		                Scratch.GetData() + (Y - Input.Min.Y) * Width + Output.Min.X - Input.Min.X,
+		                Output.Width() * sizeof(uint16));
+	}
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Grid/ESGridStorage.h"
+
+class FESGridCore;
+struct FGridEditBatch;
+
+/**
+ * 4-neighbour (Manhattan) distance from every cell to the nearest source cell, capped at a maximum distance.
+ * Sources are the cells whose ground type is in a mask, None included, so "distance to the island edge" is a None field.
+ * An edit only recomputes the cells within the cap of its dirty rect, a full rebuild can run on worker threads.
+ */
+class EVEOFTHESTORM_API FESGridDistanceField
+{
+public:
+	// Bounds is the area the field covers, max exclusive. SourceMask has bit 1 << EGroundType set for every source type
+	void Initialize(const FESGridCore* InCore, const FIntRect& InBounds, uint32 InSourceMask, int32 InMaxDistance);
+
+	void Rebuild(bool bParallel);
+
+	// Recompute around the dirty rect of a committed batch, large batches rebuild everything
+	void Update(const FGridEditBatch& Batch);
+
+	// Distance to the nearest source, MaxDistance when there is none that close or outside the field
+	FORCEINLINE int32 GetDistance(int32 X, int32 Y) const
+	{
+		return Bounds.Contains(FIntPoint(X, Y)) ? Distances[(Y - Bounds.Min.Y) * Bounds.Width() + X - Bounds.Min.X] : MaxDistance;
+	}
+
+	// Linear falloff, 1 on a source and 0 from MaxDistance on
+	FORCEINLINE float GetInfluence(int32 X, int32 Y) const
+	{
+		return 1.f - static_cast<float>(GetDistance(X, Y)) / MaxDistance;
+	}
+
+	// Row-major distances over Bounds, for sampling without any lookup
+	const TArray<uint16>& GetDistances() const { return Distances; }
+
+	const FIntRect& GetBounds() const { return Bounds; }
+
+	int32 GetMaxDistance() const { return MaxDistance; }
+
+	uint32 GetSourceMask() const { return SourceMask; }
+
+private:
+	// Exact distances of Output from the sources in Input, Input must reach MaxDistance past Output where it can
+	void ComputeRegion(const FIntRect& Input, const FIntRect& Output, bool bParallel);
+
+	const FESGridCore* Core = nullptr;
+
+	FIntRect Bounds;
+
+	uint32 SourceMask = 0;
+
+	int32 MaxDistance = 1;
+
+	TArray<uint16> Distances;
+
+	TArray<uint16> Scratch;
+};
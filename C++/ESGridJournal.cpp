@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridJournal.cpp#
+ * Author: Yuyang Qiu
+ * Function:Undo and redo history of the grid as a ring of cell deltas.
+ */
+
+#include "Core/Grid/ESGridJournal.h"
+
+void FESGridJournal::Initialize(int32 InMaxSteps, int32 InMaxCells)
+{
+	MaxSteps = FMath::Max(InMaxSteps, 0);
+	Cells.Empty(FMath::Max(InMaxCells, 0));
+	Cells.SetNum(FMath::Max(InMaxCells, 0));
+	Reset();
+}
+
+void FESGridJournal::Reset()
+{
+	Steps.Reset();
+	Cursor = 0;
+	NumCells = 0;
+}
+
+void FESGridJournal::Record(const FGridEditBatch& Batch)
+{
+	const int32 Num = Batch.Changes.Num();
+	if (Num == 0)
+	{
+		return;
+	}
+
+	// An edit that cannot be undone also cuts off every older step
+	if (MaxSteps == 0 || Num > Cells.Num())
+	{
+		Reset();
+		return;
+	}
+
+	while (Steps.Num() > Cursor)
+	{
+		NumCells -= Steps.Pop(false).Num;
+	}
+	while (Steps.Num() >= MaxSteps || Cells.Num() - NumCells < Num)
+	{
+		DropOldest();
+	}
+
+	FStep Step;
+	Step.Start = Steps.Num() > 0 ? (Steps.Last().Start + Steps.Last().Num) % Cells.Num() : 0;
+	Step.Num = Num;
+
+	// The ring may wrap inside one step
+	const int32 FirstPart = FMath::Min(Num, Cells.Num() - Step.Start);
+	FMemory::Memcpy(Cells.GetData() + Step.Start, Batch.Changes.GetData(), FirstPart * sizeof(FGridCellChange));
+	FMemory::Memcpy(Cells.GetData(), Batch.Changes.GetData() + FirstPart, (Num - FirstPart) * sizeof(FGridCellChange));
+
+	Steps.Add(Step);
+	NumCells += Num;
+	Cursor = Steps.Num();
+}
+
+bool FESGridJournal::Undo(TArray<FGridCellChange>& OutChanges)
+{
+	if (!CanUndo())
+	{
+		return false;
+	}
+	CopyCells(Steps[--Cursor], OutChanges);
+	return true;
+}
+
+bool FESGridJournal::Redo(TArray<FGridCellChange>& OutChanges)
+{
+	if (!CanRedo())
+	{
+		return false;
+	}
+	CopyCells(Steps[Cursor++], OutChanges);
+	return true;
+}
+
+void FESGridJournal::CopyCells(const FStep& Step, TArray<FGridCellChange>& OutChanges) const
+{
+	const int32 FirstPart = FMath::Min(Step.Num, Cells.Num() - Step.Start);
+	OutChanges.Reset(Step.Num);
+	OutChanges.Append(Cells.GetData() + Step.Start, FirstPart);
+	OutChanges.Append(Cells.GetData(), Step.Num - FirstPart);
+}
+
+void FESGridJournal::DropOldest()
+{
+	NumCells -= Steps[0].Num;
+	Steps.RemoveAt(0, 1, false);
+	Cursor = FMath::Max(Cursor - 1, 0);
+}
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Grid/ESGridCore.h"
+
+/**
+ * Bounded undo history of committed grid edits.
+ * Every edit keeps only its changed cells, all of them share one ring buffer.
+ * The oldest edits are dropped when the ring or the step limit is full.
+ */
+class EVEOFTHESTORM_API FESGridJournal
+{
+public:
+	void Initialize(int32 InMaxSteps, int32 InMaxCells);
+
+	void Reset();
+
+	// Store a committed edit, discarding every step that could still be redone
+	void Record(const FGridEditBatch& Batch);
+
+	bool CanUndo() const { return Cursor > 0; }
+
+	bool CanRedo() const { return Cursor < Steps.Num(); }
+
+	// Cells of the step to revert, apply their OldType
+	bool Undo(TArray<FGridCellChange>& OutChanges);
+
+	// Cells of the step to apply again, apply their NewType
+	bool Redo(TArray<FGridCellChange>& OutChanges);
+
+	int32 GetNumCells() const { return NumCells; }
+
+private:
+	struct FStep
+	{
+		// Ring position of the first cell
+		int32 Start = 0;
+
+		int32 Num = 0;
+	};
+
+	void CopyCells(const FStep& Step, TArray<FGridCellChange>& OutChanges) const;
+
+	void DropOldest();
+
+	TArray<FGridCellChange> Cells;
+
+	// Oldest first, steps from Cursor on can be redone
+	TArray<FStep> Steps;
+
+	int32 Cursor = 0;
+
+	int32 NumCells = 0;
+
+	int32 MaxSteps = 0;
+};
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridNavigation.cpp#
+ * Author: Yuyang Qiu
+ * Function:Pathfinding over the grid ground with per ground type move costs.
+ */
+
+#include "Core/Grid/ESGridNavigation.h"
+
+#include "Core/Grid/ESGridSystem.h"
+
+void UESGridNavigation::Initialize(UESGridSystem* InGridSystem)
+{
+	if (GridSystem)
+	{
+		GridSystem->OnTilesChanged().RemoveAll(this);
+		GridSystem->OnGridLoaded().RemoveAll(this);
+	}
+
+	GridSystem = InGridSystem;
+	if (GridSystem)
+	{
+		GridSystem->OnTilesChanged().AddUObject(this, &UESGridNavigation::OnTilesChanged);
+		GridSystem->OnGridLoaded().AddUObject(this, &UESGridNavigation::OnGridLoaded);
+	}
+	ApplyMoveCosts();
+}
+
+void UESGridNavigation::ApplyMoveCosts()
+{
+	float Costs[GroundTypeCount];
+	for (int32 Type = 0; Type < GroundTypeCount; ++Type)
+	{
+		const float* Cost = MoveCosts.Find(static_cast<EGroundType>(Type));
+		Costs[Type] = Cost ? *Cost : 1.f;
+	}
+	Pathfinder.Initialize(GridSystem ? &GridSystem->GetCore() : nullptr, Costs);
+}
+
+bool UESGridNavigation::FindPath(FIntPoint Start, FIntPoint Goal, TArray<FIntPoint>& OutPath, float& OutCost)
+{
+	OutCost = 0.f;
+	return Pathfinder.FindPath(Start, Goal, OutPath, &OutCost);
+}
+
+bool UESGridNavigation::IsWalkable(int X, int Y) const
+{
+	return GridSystem && Pathfinder.IsWalkable(X, Y);
+}
+
+void UESGridNavigation::OnTilesChanged(const FGridEditBatch& Batch)
+{
+	Pathfinder.MarkDirty(Batch);
+}
+
+void UESGridNavigation::OnGridLoaded()
+{
+	Pathfinder.Rebuild();
+}
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Core/Types/GroundType.h"
+#include "Core/Grid/ESGridPathfinder.h"
+#include "ESGridNavigation.generated.h"
+
+class UESGridSystem;
+
+/**
+ * Unit movement over the ground of a grid system, kept in sync through its change events.
+ */
+UCLASS(BlueprintType)
+class EVEOFTHESTORM_API UESGridNavigation : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	// Cost of walking onto a cell of each type, missing types cost 1. A cost <= 0 blocks the type
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+		TMap<EGroundType, float> MoveCosts;
+
+	UFUNCTION(BlueprintCallable)
+		void Initialize(UESGridSystem* InGridSystem);
+
+	// Rebuild with the current MoveCosts
+	UFUNCTION(BlueprintCallable)
+		void ApplyMoveCosts();
+
+	// Cells from Start to Goal, both included
+	UFUNCTION(BlueprintCallable)
+		bool FindPath(FIntPoint Start, FIntPoint Goal, TArray<FIntPoint>& OutPath, float& OutCost);
+
+	UFUNCTION(BlueprintCallable)
+		bool IsWalkable(int X, int Y) const;
+
+	const FESGridPathfinder& GetPathfinder() const { return Pathfinder; }
+
+protected:
+	void OnTilesChanged(const FGridEditBatch& Batch);
+
+	void OnGridLoaded();
+
+	UPROPERTY(Transient)
+		UESGridSystem* GridSystem;
+
+	FESGridPathfinder Pathfinder;
+};
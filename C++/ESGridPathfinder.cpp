@@ -0,0 +1,482 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridPathfinder.cpp#
+ * Author: Yuyang Qiu
+ * Function:Windowed A* and a cluster graph for long paths over the grid ground.
+ */
+
+#include "Core/Grid/ESGridPathfinder.h"
+
+#include "Core/Grid/ESGridCore.h"
+#include "Core/Grid/ESGridStats.h"
+
+// Parents are stored as the index of the step that entered a cell
+static const FIntPoint GPathSteps[4] = {FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1)};
+
+static FORCEINLINE int32 GetManhattanDistance(FIntPoint A, FIntPoint B)
+{
+	return FMath::Abs(A.X - B.X) + FMath::Abs(A.Y - B.Y);
+}
+
+void FESGridPathfinder::Initialize(const FESGridCore* InCore, TArrayView<const float> InCosts)
+{
+	Core = InCore;
+
+	MinCost = MAX_flt;
+	for (int32 Type = 0; Type < GroundTypeCount; ++Type)
+	{
+		Costs[Type] = Type > 0 && InCosts.IsValidIndex(Type) ? FMath::Max(InCosts[Type], 0.f) : 0.f;
+		if (Costs[Type] > 0.f)
+		{
+			MinCost = FMath::Min(MinCost, Costs[Type]);
+		}
+	}
+	if (MinCost == MAX_flt)
+	{
+		MinCost = 1.f;
+	}
+
+	Rebuild();
+}
+
+void FESGridPathfinder::Rebuild()
+{
+	Clusters.Reset();
+	DirtyClusters.Reset();
+	if (!Core)
+	{
+		return;
+	}
+
+	for (int32 Type = 1; Type < GroundTypeCount; ++Type)
+	{
+		if (Costs[Type] <= 0.f)
+		{
+			continue;
+		}
+		for (const int32 Index : Core->GetOccupiedCells(static_cast<EGroundType>(Type)))
+		{
+			DirtyClusters.Add(GetClusterKey(Core->GetStorage().ToPoint(Index)));
+		}
+	}
+	FlushDirty();
+}
+
+void FESGridPathfinder::MarkDirty(const FGridEditBatch& Batch)
+{
+	for (const FGridCellChange& Change : Batch.Changes)
+	{
+		const FIntPoint Cell(Change.X, Change.Y);
+		const FIntPoint Key = GetClusterKey(Cell);
+		DirtyClusters.Add(Key);
+
+		// Border cells also change the openings of the cluster next door
+		const FIntPoint Local(Cell.X & (ClusterSize - 1), Cell.Y & (ClusterSize - 1));
+		if (Local.X == 0)
+		{
+			DirtyClusters.Add(Key - FIntPoint(1, 0));
+		}
+		else if (Local.X == ClusterSize - 1)
+		{
+			DirtyClusters.Add(Key + FIntPoint(1, 0));
+		}
+		if (Local.Y == 0)
+		{
+			DirtyClusters.Add(Key - FIntPoint(0, 1));
+		}
+		else if (Local.Y == ClusterSize - 1)
+		{
+			DirtyClusters.Add(Key + FIntPoint(0, 1));
+		}
+	}
+}
+
+int32 FESGridPathfinder::GetNumNodes() const
+{
+	int32 Num = 0;
+	for (const auto& Pair : Clusters)
+	{
+		Num += Pair.Value.Nodes.Num();
+	}
+	return Num;
+}
+
+bool FESGridPathfinder::FindPath(FIntPoint Start, FIntPoint Goal, TArray<FIntPoint>& OutPath, float* OutCost)
+{
+	ES_GRID_SCOPE(FindPath);
+
+	OutPath.Reset();
+	if (!Core || !IsWalkable(Start.X, Start.Y) || !IsWalkable(Goal.X, Goal.Y))
+	{
+		return false;
+	}
+	FlushDirty();
+
+	float Cost = 0.f;
+	bool bFound = false;
+	if (Start == Goal)
+	{
+		OutPath.Add(Start);
+		bFound = true;
+	}
+	else if (GetManhattanDistance(Start, Goal) <= LocalRange)
+	{
+		const FIntPoint Margin(ClusterSize / 2, ClusterSize / 2);
+		const FIntRect Window(Start.ComponentMin(Goal) - Margin, Start.ComponentMax(Goal) + Margin + FIntPoint(1, 1));
+		if (Search(Window, Start, &Goal))
+		{
+			OutPath.Add(Start);
+			AppendSearchPath(Goal, OutPath);
+			Cost = GetSearchCost(Goal);
+			bFound = true;
+		}
+	}
+
+	// Long paths, and short ones that have to leave the window
+	if (!bFound)
+	{
+		bFound = FindAbstractPath(Start, Goal, OutPath, Cost);
+	}
+
+	if (bFound && OutCost)
+	{
+		*OutCost = Cost;
+	}
+	return bFound;
+}
+
+void FESGridPathfinder::FlushDirty()
+{
+	for (const FIntPoint& Key : DirtyClusters)
+	{
+		BuildCluster(Key);
+	}
+	DirtyClusters.Reset();
+}
+
+void FESGridPathfinder::BuildCluster(FIntPoint Key)
+{
+	const FIntRect Rect = GetClusterRect(Key);
+
+	// First inside cell, step along the border and outward normal of each side
+	const FIntPoint Sides[4][3] =
+	{
+		{Rect.Min, FIntPoint(0, 1), FIntPoint(-1, 0)},
+		{FIntPoint(Rect.Max.X - 1, Rect.Min.Y), FIntPoint(0, 1), FIntPoint(1, 0)},
+		{Rect.Min, FIntPoint(1, 0), FIntPoint(0, -1)},
+		{FIntPoint(Rect.Min.X, Rect.Max.Y - 1), FIntPoint(1, 0), FIntPoint(0, 1)}
+	};
+
+	FCluster Cluster;
+	auto AddLink = [this, &Cluster](FIntPoint Inside, FIntPoint Outside)
+	{
+		int32 NodeIndex = Cluster.FindNode(Inside);
+		if (NodeIndex == INDEX_NONE)
+		{
+			NodeIndex = Cluster.Nodes.AddDefaulted();
+			Cluster.Nodes[NodeIndex].Cell = Inside;
+		}
+		Cluster.Nodes[NodeIndex].Links.AddUnique(Outside);
+	};
+
+	// Both clusters of a border scan it in the same order, so they agree on the openings
+	for (const FIntPoint* Side : Sides)
+	{
+		int32 RunStart = INDEX_NONE;
+		for (int32 i = 0; i <= ClusterSize; ++i)
+		{
+			const FIntPoint Inside = Side[0] + Side[1] * i;
+			const bool bOpen = i < ClusterSize && IsWalkable(Inside.X, Inside.Y)
+				&& IsWalkable(Inside.X + Side[2].X, Inside.Y + Side[2].Y);
+			if (bOpen && RunStart == INDEX_NONE)
+			{
+				RunStart = i;
+			}
+			else if (!bOpen && RunStart != INDEX_NONE)
+			{
+				// Wide openings get a node at each end so paths along them stay straight
+				const int32 RunEnd = i - 1;
+				if (RunEnd - RunStart >= ClusterSize / 4)
+				{
+					AddLink(Side[0] + Side[1] * RunStart, Side[0] + Side[1] * RunStart + Side[2]);
+					AddLink(Side[0] + Side[1] * RunEnd, Side[0] + Side[1] * RunEnd + Side[2]);
+				}
+				else
+				{
+					const int32 Middle = (RunStart + RunEnd) / 2;
+					AddLink(Side[0] + Side[1] * Middle, Side[0] + Side[1] * Middle + Side[2]);
+				}
+				RunStart = INDEX_NONE;
+			}
+		}
+	}
+
+	const int32 NumNodes = Cluster.Nodes.Num();
+	if (NumNodes == 0)
+	{
+		Clusters.Remove(Key);
+		return;
+	}
+
+	// Steps are symmetric, one search per node fills a row and a column
+	Cluster.Paths.SetNumUninitialized(NumNodes * NumNodes);
+	for (int32 i = 0; i < NumNodes; ++i)
+	{
+		Search(Rect, Cluster.Nodes[i].Cell, nullptr);
+		for (int32 j = i; j < NumNodes; ++j)
+		{
+			const float Cost = GetSearchCost(Cluster.Nodes[j].Cell);
+			Cluster.Paths[i * NumNodes + j] = Cost;
+			Cluster.Paths[j * NumNodes + i] = Cost;
+		}
+	}
+	Clusters.Add(Key, MoveTemp(Cluster));
+}
+
+bool FESGridPathfinder::Search(const FIntRect& Limit, FIntPoint Start, const FIntPoint* Goal)
+{
+	SearchRect = Limit;
+	const int32 Width = Limit.Width();
+	const int32 Area = Width * Limit.Height();
+	if (SearchStamps.Num() < Area)
+	{
+		SearchCosts.SetNumUninitialized(Area);
+		SearchParents.SetNumUninitialized(Area);
+		SearchStamps.SetNumZeroed(Area);
+	}
+	if (++SearchGeneration == 0)
+	{
+		FMemory::Memzero(SearchStamps.GetData(), SearchStamps.Num() * sizeof(uint32));
+		SearchGeneration = 1;
+	}
+
+	auto Less = [](const FOpenEntry& A, const FOpenEntry& B) { return A.F < B.F; };
+	auto Heuristic = [this, Goal](FIntPoint Cell) { return Goal ? GetManhattanDistance(Cell, *Goal) * MinCost : 0.f; };
+
+	OpenList.Reset();
+	const int32 StartLocal = (Start.Y - Limit.Min.Y) * Width + Start.X - Limit.Min.X;
+	SearchStamps[StartLocal] = SearchGeneration;
+	SearchCosts[StartLocal] = 0.f;
+	SearchParents[StartLocal] = INDEX_NONE;
+	OpenList.HeapPush({Heuristic(Start), 0.f, StartLocal}, Less);
+
+	while (OpenList.Num() > 0)
+	{
+		FOpenEntry Entry;
+		OpenList.HeapPop(Entry, Less, false);
+
+		// Superseded by a cheaper entry of the same cell
+		if (Entry.G > SearchCosts[Entry.Local])
+		{
+			continue;
+		}
+
+		const FIntPoint Cell(Limit.Min.X + Entry.Local % Width, Limit.Min.Y + Entry.Local / Width);
+		if (Goal && Cell == *Goal)
+		{
+			return true;
+		}
+
+		const float CellCost = GetCellCost(Cell.X, Cell.Y);
+		for (int32 Step = 0; Step < 4; ++Step)
+		{
+			const FIntPoint Next = Cell + GPathSteps[Step];
+			if (!Limit.Contains(Next))
+			{
+				continue;
+			}
+			const float NextCost = GetCellCost(Next.X, Next.Y);
+			if (NextCost <= 0.f)
+			{
+				continue;
+			}
+
+			const float G = Entry.G + (CellCost + NextCost) * 0.5f;
+			const int32 NextLocal = (Next.Y - Limit.Min.Y) * Width + Next.X - Limit.Min.X;
+			if (SearchStamps[NextLocal] == SearchGeneration && SearchCosts[NextLocal] <= G)
+			{
+				continue;
+			}
+			SearchStamps[NextLocal] = SearchGeneration;
+			SearchCosts[NextLocal] = G;
+			SearchParents[NextLocal] = static_cast<int8>(Step);
+			OpenList.HeapPush({G + Heuristic(Next), G, NextLocal}, Less);
+		}
+	}
+	return Goal == nullptr;
+}
+
+float FESGridPathfinder::GetSearchCost(FIntPoint Cell) const
+{
+	if (!SearchRect.Contains(Cell))
+	{
+		return MAX_flt;
+	}
+	const int32 Local = (Cell.Y - SearchRect.Min.Y) * SearchRect.Width() + Cell.X - SearchRect.Min.X;
+	return SearchStamps[Local] == SearchGeneration ? SearchCosts[Local] : MAX_flt;
+}
+
+void FESGridPathfinder::AppendSearchPath(FIntPoint Cell, TArray<FIntPoint>& OutPath) const
+{
+	const int32 First = OutPath.Num();
+	const int32 Width = SearchRect.Width();
+	while (true)
+	{
+		const int32 Step = SearchParents[(Cell.Y - SearchRect.Min.Y) * Width + Cell.X - SearchRect.Min.X];
+		if (Step == INDEX_NONE)
+		{
+			break;
+		}
+		OutPath.Add(Cell);
+		Cell -= GPathSteps[Step];
+	}
+
+	// Collected goal first
+	for (int32 i = First, j = OutPath.Num() - 1; i < j; ++i, --j)
+	{
+		OutPath.Swap(i, j);
+	}
+}
+
+bool FESGridPathfinder::FindAbstractPath(FIntPoint Start, FIntPoint Goal, TArray<FIntPoint>& OutPath, float& OutCost)
+{
+	struct FRecord
+	{
+		float G;
+
+		FIntPoint Parent;
+	};
+
+	struct FEntry
+	{
+		float F;
+
+		float G;
+
+		FIntPoint Cell;
+	};
+
+	const FIntPoint StartKey = GetClusterKey(Start);
+	const FIntPoint GoalKey = GetClusterKey(Goal);
+
+	// Cost from every node of the goal cluster to the goal
+	TArray<float> GoalCosts;
+	if (const FCluster* GoalCluster = Clusters.Find(GoalKey))
+	{
+		Search(GetClusterRect(GoalKey), Goal, nullptr);
+		for (const FClusterNode& Node : GoalCluster->Nodes)
+		{
+			GoalCosts.Add(GetSearchCost(Node.Cell));
+		}
+	}
+
+	TMap<FIntPoint, FRecord> Records;
+	TArray<FEntry> Open;
+	auto Less = [](const FEntry& A, const FEntry& B) { return A.F < B.F; };
+	auto Push = [this, &Records, &Open, &Less, Goal](FIntPoint Cell, float G, FIntPoint Parent)
+	{
+		const FRecord* Record = Records.Find(Cell);
+		if (Record && Record->G <= G)
+		{
+			return;
+		}
+		Records.Add(Cell, {G, Parent});
+		Open.HeapPush({G + GetManhattanDistance(Cell, Goal) * MinCost, G, Cell}, Less);
+	};
+
+	// The start joins the graph through the nodes of its own cluster
+	Search(GetClusterRect(StartKey), Start, nullptr);
+	if (StartKey == GoalKey && GetSearchCost(Goal) < MAX_flt)
+	{
+		Push(Goal, GetSearchCost(Goal), Start);
+	}
+	if (const FCluster* StartCluster = Clusters.Find(StartKey))
+	{
+		for (const FClusterNode& Node : StartCluster->Nodes)
+		{
+			const float Cost = GetSearchCost(Node.Cell);
+			if (Cost < MAX_flt)
+			{
+				Push(Node.Cell, Cost, Start);
+			}
+		}
+	}
+
+	bool bFound = false;
+	while (Open.Num() > 0)
+	{
+		FEntry Entry;
+		Open.HeapPop(Entry, Less, false);
+		if (Entry.G > Records.FindChecked(Entry.Cell).G)
+		{
+			continue;
+		}
+		if (Entry.Cell == Goal)
+		{
+			bFound = true;
+			break;
+		}
+
+		const FIntPoint Key = GetClusterKey(Entry.Cell);
+		const FCluster* Cluster = Clusters.Find(Key);
+		const int32 NodeIndex = Cluster ? Cluster->FindNode(Entry.Cell) : INDEX_NONE;
+		if (NodeIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		const int32 NumNodes = Cluster->Nodes.Num();
+		for (int32 i = 0; i < NumNodes; ++i)
+		{
+			const float Cost = Cluster->Paths[NodeIndex * NumNodes + i];
+			if (i != NodeIndex && Cost < MAX_flt)
+			{
+				Push(Cluster->Nodes[i].Cell, Entry.G + Cost, Entry.Cell);
+			}
+		}
+		for (const FIntPoint& Link : Cluster->Nodes[NodeIndex].Links)
+		{
+			Push(Link, Entry.G + GetStepCost(Entry.Cell, Link), Entry.Cell);
+		}
+		if (Key == GoalKey && GoalCosts[NodeIndex] < MAX_flt)
+		{
+			Push(Goal, Entry.G + GoalCosts[NodeIndex], Entry.Cell);
+		}
+	}
+	if (!bFound)
+	{
+		return false;
+	}
+
+	TArray<FIntPoint> Waypoints;
+	for (FIntPoint Cell = Goal; ; Cell = Records.FindChecked(Cell).Parent)
+	{
+		Waypoints.Add(Cell);
+		if (Cell == Start)
+		{
+			break;
+		}
+	}
+
+	// Every abstract step is a border crossing or stays inside one cluster
+	OutPath.Add(Start);
+	for (int32 i = Waypoints.Num() - 1; i > 0; --i)
+	{
+		const FIntPoint From = Waypoints[i];
+		const FIntPoint To = Waypoints[i - 1];
+		if (GetManhattanDistance(From, To) == 1)
+		{
+			OutPath.Add(To);
+			continue;
+		}
+		if (!Search(GetClusterRect(GetClusterKey(From)), From, &To))
+		{
+			OutPath.Reset();
+			return false;
+		}
+		AppendSearchPath(To, OutPath);
+	}
+	OutCost = Records.FindChecked(Goal).G;
+	return true;
+}
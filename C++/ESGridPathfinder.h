@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Grid/ESGridStorage.h"
+
+class FESGridCore;
+struct FGridEditBatch;
+
+/**
+ * Paths over the ground of a grid, moving between 4-neighbours.
+ * Short paths are plain A* in a window around both ends, long ones search a graph of 32x32 clusters
+ * joined at their border openings, then refine each abstract step inside one cluster.
+ * Clusters are rebuilt lazily after edits, only the ones an edit touched.
+ */
+class EVEOFTHESTORM_API FESGridPathfinder
+{
+public:
+	static constexpr int32 ClusterShift = 5;
+	static constexpr int32 ClusterSize = 1 << ClusterShift;
+
+	// Ends closer than this in Manhattan distance try a windowed A* first
+	static constexpr int32 LocalRange = ClusterSize * 2;
+
+	// Costs are indexed by EGroundType, a cost <= 0 makes a type impassable. None never is passable
+	void Initialize(const FESGridCore* InCore, TArrayView<const float> InCosts);
+
+	// Throw the cluster graph away and build it again from the whole grid
+	void Rebuild();
+
+	// Mark the clusters of the changed cells, and the neighbours sharing a border with them
+	void MarkDirty(const FGridEditBatch& Batch);
+
+	// Cheapest path from Start to Goal, both included. False when no path exists
+	bool FindPath(FIntPoint Start, FIntPoint Goal, TArray<FIntPoint>& OutPath, float* OutCost = nullptr);
+
+	FORCEINLINE float GetCellCost(int32 X, int32 Y) const
+	{
+		return Costs[static_cast<int32>(Core->Get(X, Y))];
+	}
+
+	bool IsWalkable(int32 X, int32 Y) const { return GetCellCost(X, Y) > 0.f; }
+
+	int32 GetNumClusters() const { return Clusters.Num(); }
+
+	int32 GetNumNodes() const;
+
+private:
+	// Border cell of a cluster with a walkable cell right across the border
+	struct FClusterNode
+	{
+		FIntPoint Cell;
+
+		// Cells across the border, a corner cell can have two
+		TArray<FIntPoint, TInlineAllocator<2>> Links;
+	};
+
+	struct FCluster
+	{
+		TArray<FClusterNode> Nodes;
+
+		// Nodes.Num() squared path costs inside the cluster, MAX_flt when unreachable
+		TArray<float> Paths;
+
+		int32 FindNode(FIntPoint Cell) const
+		{
+			return Nodes.IndexOfByPredicate([Cell](const FClusterNode& Node) { return Node.Cell == Cell; });
+		}
+	};
+
+	struct FOpenEntry
+	{
+		float F;
+
+		float G;
+
+		int32 Local;
+	};
+
+	static FORCEINLINE FIntPoint GetClusterKey(FIntPoint Cell)
+	{
+		return FIntPoint(Cell.X >> ClusterShift, Cell.Y >> ClusterShift);
+	}
+
+	static FORCEINLINE FIntRect GetClusterRect(FIntPoint Key)
+	{
+		return FIntRect(Key * ClusterSize, (Key + FIntPoint(1, 1)) * ClusterSize);
+	}
+
+	// Cost of one step, the mean of both cells so every edge is symmetric
+	FORCEINLINE float GetStepCost(FIntPoint From, FIntPoint To) const
+	{
+		return (GetCellCost(From.X, From.Y) + GetCellCost(To.X, To.Y)) * 0.5f;
+	}
+
+	void FlushDirty();
+
+	void BuildCluster(FIntPoint Key);
+
+	/**
+	 * A* from Start to Goal without leaving Limit, or Dijkstra over all of Limit when Goal is null.
+	 * Results stay in the search buffers until the next search.
+	 */
+	bool Search(const FIntRect& Limit, FIntPoint Start, const FIntPoint* Goal);
+
+	// Cost found by the last search, MAX_flt when the cell was not reached
+	float GetSearchCost(FIntPoint Cell) const;
+
+	// Append the path of the last search ending at Cell, without its first cell
+	void AppendSearchPath(FIntPoint Cell, TArray<FIntPoint>& OutPath) const;
+
+	bool FindAbstractPath(FIntPoint Start, FIntPoint Goal, TArray<FIntPoint>& OutPath, float& OutCost);
+
+	const FESGridCore* Core = nullptr;
+
+	float Costs[GroundTypeCount] = {};
+
+	// Lowest walkable cost, scales the heuristic so it stays admissible
+	float MinCost = 1.f;
+
+	TMap<FIntPoint, FCluster> Clusters;
+
+	TSet<FIntPoint> DirtyClusters;
+
+	// SEARCH BUFFERS
+
+	FIntRect SearchRect;
+
+	TArray<float> SearchCosts;
+
+	// Direction index back to the parent cell, INDEX_NONE for the start
+	TArray<int8> SearchParents;
+
+	// Entries are only valid when they carry the current generation
+	TArray<uint32> SearchStamps;
+
+	uint32 SearchGeneration = 0;
+
+	TArray<FOpenEntry> OpenList;
+};
@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridQueryService.cpp#
+ * Author: Yuyang Qiu
+ * Function:Batched placement queries answered off the game thread.
+ */
+
+#include "Core/Grid/ESGridQueryService.h"
+
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+
+FESGridQueryService::FESGridQueryService(UESGridSystem* InGridSystem) : GridSystem(InGridSystem)
+{
+}
+
+TFuture<FGridPlacementQueryBatch> FESGridQueryService::Submit(const TArray<FGridPlacementQuery>& Queries)
+{
+	if (!CanPrepare())
+	{
+		return MakeFulfilledPromise<FGridPlacementQueryBatch>(MakeRejectedBatch(Queries.Num())).GetFuture();
+	}
+
+	const TSharedRef<FPreparedBatch, ESPMode::ThreadSafe> Batch = Prepare(Queries);
+	return Async(EAsyncExecution::TaskGraph, [Batch]()
+	{
+		return Execute(*Batch);
+	});
+}
+
+void FESGridQueryService::Submit(const TArray<FGridPlacementQuery>& Queries,
+                                 TFunction<void(const FGridPlacementQueryBatch&)> OnComplete)
+{
+	if (!CanPrepare())
+	{
+		// Still delivered later, never from inside Submit
+		AsyncTask(ENamedThreads::GameThread, [OnComplete = MoveTemp(OnComplete), Result = MakeRejectedBatch(Queries.Num())]()
+		{
+			OnComplete(Result);
+		});
+		return;
+	}
+
+	const TSharedRef<FPreparedBatch, ESPMode::ThreadSafe> Batch = Prepare(Queries);
+	TWeakObjectPtr<UESGridSystem> WeakGridSystem = GridSystem;
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [Batch, WeakGridSystem, OnComplete = MoveTemp(OnComplete)]() mutable
+	{
+		FGridPlacementQueryBatch Result = Execute(*Batch);
+		AsyncTask(ENamedThreads::GameThread, [WeakGridSystem, OnComplete = MoveTemp(OnComplete), Result = MoveTemp(Result)]() mutable
+		{
+			if (const UESGridSystem* Grid = WeakGridSystem.Get())
+			{
+				Result.bStale = Result.EditVersion != Grid->GetEditVersion();
+				OnComplete(Result);
+			}
+		});
+	});
+}
+
+bool FESGridQueryService::IsStale(const FGridPlacementQueryBatch& Batch) const
+{
+	const UESGridSystem* Grid = GridSystem.Get();
+	return !Grid || Batch.EditVersion != Grid->GetEditVersion();
+}
+
+bool FESGridQueryService::CanPrepare() const
+{
+	const UESGridSystem* Grid = GridSystem.Get();
+	check(Grid);
+	return ensureMsgf(!Grid->IsEditing(), TEXT("Placement queries cannot be submitted inside a grid edit"));
+}
+
+FGridPlacementQueryBatch FESGridQueryService::MakeRejectedBatch(int32 NumQueries)
+{
+	FGridPlacementQueryBatch Result;
+	Result.bStale = true;
+	Result.Results.SetNum(NumQueries);
+	for (FGridPlacementQueryResult& Query : Result.Results)
+	{
+		Query.bHasTile = true;
+	}
+	return Result;
+}
+
+TSharedRef<FESGridQueryService::FPreparedBatch, ESPMode::ThreadSafe> FESGridQueryService::Prepare(
+	const TArray<FGridPlacementQuery>& Queries)
+{
+	check(IsInGameThread());
+	UESGridSystem* Grid = GridSystem.Get();
+	check(Grid);
+
+	if (!Snapshot.IsValid() || Snapshot->GetEditVersion() != Grid->GetEditVersion())
+	{
+		Snapshot = Grid->TakeSnapshot();
+	}
+
+	// Footprints are copied, the batch owns everything a worker reads and can outlive the grid system
+	const TSharedRef<FPreparedBatch, ESPMode::ThreadSafe> Batch = MakeShared<FPreparedBatch, ESPMode::ThreadSafe>(
+		FPreparedBatch{Snapshot.ToSharedRef()});
+	Batch->ShapeIndices.Reserve(Queries.Num());
+	Batch->Anchors.Reserve(Queries.Num());
+	const FESGridCore& Core = Grid->GetCore();
+	// Shape handle index and direction to the copy in Batch->Shapes
+	TMap<FIntPoint, int32> ShapeCopies;
+	for (const FGridPlacementQuery& Query : Queries)
+	{
+		const FESGridShapeHandle Shape = Core.ResolveShape(Query.Tile.Shape);
+		Batch->Anchors.Add(FIntPoint(Query.X, Query.Y));
+		// Shapes the library refused are answered as blocked
+		if (!Shape.IsValid())
+		{
+			Batch->ShapeIndices.Add(INDEX_NONE);
+			continue;
+		}
+		const FIntPoint Key(Shape.Index, static_cast<int32>(Query.Direction));
+		int32* ShapeIndex = ShapeCopies.Find(Key);
+		if (!ShapeIndex)
+		{
+			const FGridShapeRotation& Rotation = Core.GetShapeLibrary().Get(Shape).GetRotation(Query.Direction);
+			FGridShapeRotation& Copy = Batch->Shapes.AddDefaulted_GetRef();
+			Copy.Min = Rotation.Min;
+			Copy.Max = Rotation.Max;
+			Copy.RowMasks = Rotation.RowMasks;
+			ShapeIndex = &ShapeCopies.Add(Key, Batch->Shapes.Num() - 1);
+		}
+		Batch->ShapeIndices.Add(*ShapeIndex);
+	}
+	return Batch;
+}
+
+FGridPlacementQueryBatch FESGridQueryService::Execute(const FPreparedBatch& Batch)
+{
+	constexpr int32 QueriesPerTask = 64;
+
+	FGridPlacementQueryBatch Result;
+	Result.EditVersion = Batch.Snapshot->GetEditVersion();
+	Result.Results.SetNum(Batch.Anchors.Num());
+
+	const int32 NumTasks = FMath::DivideAndRoundUp(Batch.Anchors.Num(), QueriesPerTask);
+	ParallelFor(NumTasks, [&](int32 Task)
+	{
+		const int32 End = FMath::Min((Task + 1) * QueriesPerTask, Batch.Anchors.Num());
+		for (int32 i = Task * QueriesPerTask; i < End; ++i)
+		{
+			const FIntPoint Anchor = Batch.Anchors[i];
+			FGridPlacementQueryResult& Query = Result.Results[i];
+			if (Batch.ShapeIndices[i] == INDEX_NONE)
+			{
+				Query.bHasTile = true;
+				continue;
+			}
+			const FGridShapeRotation& Shape = Batch.Shapes[Batch.ShapeIndices[i]];
+			Query.bHasTile = Batch.Snapshot->HasShape(Anchor.X, Anchor.Y, Shape);
+			Query.bCanPlace = Batch.Snapshot->CanPlaceShape(Anchor.X, Anchor.Y, Shape);
+		}
+	});
+	return Result;
+}
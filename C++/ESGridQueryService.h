@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Core/Grid/ESGridSystem.h"
+
+struct FGridPlacementQuery
+{
+	int32 X = 0;
+
+	int32 Y = 0;
+
+	FGridTile Tile;
+
+	EGridDirection Direction = EGridDirection::North;
+};
+
+// Answers of UESGridSystem::HasTile and UESGridSystem::CanPlaceTile for one query
+struct FGridPlacementQueryResult
+{
+	bool bHasTile = false;
+
+	bool bCanPlace = false;
+};
+
+struct FGridPlacementQueryBatch
+{
+	// Same order as the submitted queries
+	TArray<FGridPlacementQueryResult> Results;
+
+	// Grid edit version every result was computed at
+	int32 EditVersion = INDEX_NONE;
+
+	// Only filled for callback delivery, future results are checked with FESGridQueryService::IsStale
+	bool bStale = false;
+};
+
+/**
+ * Runs batches of placement queries on task graph workers against one grid snapshot.
+ * Submit on the game thread, results come back as a future or as a callback on the game thread.
+ * Submitting inside an open grid edit is a caller error: every query is answered as blocked and the batch is stale.
+ */
+class EVEOFTHESTORM_API FESGridQueryService
+{
+public:
+	explicit FESGridQueryService(UESGridSystem* InGridSystem);
+
+	TFuture<FGridPlacementQueryBatch> Submit(const TArray<FGridPlacementQuery>& Queries);
+
+	// OnComplete runs on the game thread, it is dropped if the grid system is gone by then
+	void Submit(const TArray<FGridPlacementQuery>& Queries, TFunction<void(const FGridPlacementQueryBatch&)> OnComplete);
+
+	// True when the grid was edited after the batch was computed
+	bool IsStale(const FGridPlacementQueryBatch& Batch) const;
+
+private:
+	// Snapshot and footprints of a batch, everything a worker reads
+	struct FPreparedBatch
+	{
+		FESGridSnapshotRef Snapshot;
+
+		// Copied footprints, one per distinct shape and direction of the batch, without the cell list
+		TArray<FGridShapeRotation> Shapes;
+
+		// Per query, index into Shapes or INDEX_NONE for a shape the library refused
+		TArray<int32> ShapeIndices;
+
+		TArray<FIntPoint> Anchors;
+	};
+
+	TSharedRef<FPreparedBatch, ESPMode::ThreadSafe> Prepare(const TArray<FGridPlacementQuery>& Queries);
+
+	static FGridPlacementQueryBatch Execute(const FPreparedBatch& Batch);
+
+	// Answer for a batch that cannot be prepared, no snapshot can be taken during an edit
+	static FGridPlacementQueryBatch MakeRejectedBatch(int32 NumQueries);
+
+	// Ensures no edit is open
+	bool CanPrepare() const;
+
+	TWeakObjectPtr<UESGridSystem> GridSystem;
+
+	// Reused while the grid is not edited
+	TSharedPtr<const FESGridSnapshot, ESPMode::ThreadSafe> Snapshot;
+};
@@ -0,0 +1,377 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridRegions.cpp#
+ * Author: Yuyang Qiu
+ * Function:Connected ground regions kept up to date from edit batches.
+ */
+
+#include "Core/Grid/ESGridRegions.h"
+
+#include "Core/Grid/ESGridCore.h"
+
+static const FIntPoint GRegionSteps[4] = {FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1)};
+
+void FESGridRegions::Rebuild(const FESGridCore* InCore)
+{
+	Core = InCore;
+	Chunks.Reset();
+	Parents.Reset();
+	Sizes.Reset();
+	FreeNodes.Reset();
+	NumRegions[GroundLayer] = 0;
+	NumRegions[TypeLayer] = 0;
+	NumLabels = 0;
+	if (!Core)
+	{
+		return;
+	}
+
+	const FESGridStorage& Storage = Core->GetStorage();
+	for (int32 Type = 1; Type < GroundTypeCount; ++Type)
+	{
+		for (const int32 Index : Core->GetOccupiedCells(static_cast<EGroundType>(Type)))
+		{
+			const FIntPoint Cell = Storage.ToPoint(Index);
+			AddCell(GroundLayer, Cell, nullptr);
+			AddCell(TypeLayer, Cell, nullptr);
+		}
+	}
+}
+
+void FESGridRegions::Apply(const FGridEditBatch& Batch, TArray<FGridRegionEvent>& OutEvents)
+{
+	if (!Core)
+	{
+		return;
+	}
+
+	// Removals first, so every addition joins regions that already lost their removed cells
+	for (const FGridCellChange& Change : Batch.Changes)
+	{
+		const FIntPoint Cell(Change.X, Change.Y);
+		if (Change.OldType == GroundTypeNone)
+		{
+			continue;
+		}
+		if (Change.NewType == GroundTypeNone)
+		{
+			RemoveCell(GroundLayer, Cell, GroundTypeNone, OutEvents);
+		}
+		RemoveCell(TypeLayer, Cell, Change.OldType, OutEvents);
+	}
+
+	for (const FGridCellChange& Change : Batch.Changes)
+	{
+		const FIntPoint Cell(Change.X, Change.Y);
+		if (Change.NewType == GroundTypeNone)
+		{
+			continue;
+		}
+		if (Change.OldType == GroundTypeNone)
+		{
+			AddCell(GroundLayer, Cell, &OutEvents);
+		}
+		AddCell(TypeLayer, Cell, &OutEvents);
+	}
+}
+
+int32 FESGridRegions::GetRegion(int32 X, int32 Y, bool bByType) const
+{
+	const int32 Label = GetLabel(bByType ? TypeLayer : GroundLayer, FIntPoint(X, Y));
+	return Label == INDEX_NONE ? INDEX_NONE : FindRoot(Label);
+}
+
+void FESGridRegions::SetLabel(int32 Layer, FIntPoint Cell, int32 Label)
+{
+	const FIntPoint Key(Cell.X >> FESGridStorage::ChunkShift, Cell.Y >> FESGridStorage::ChunkShift);
+	TUniquePtr<FLabelChunk>* Chunk = Chunks.Find(Key);
+	if (!Chunk)
+	{
+		if (Label == INDEX_NONE)
+		{
+			return;
+		}
+		Chunk = &Chunks.Add(Key, MakeUnique<FLabelChunk>());
+		FMemory::Memset((*Chunk)->Labels, 0xFF, sizeof(FLabelChunk::Labels));
+		FMemory::Memzero((*Chunk)->VisitStamps, sizeof(FLabelChunk::VisitStamps));
+	}
+
+	int32& Slot = (*Chunk)->Labels[Layer][GetLocalIndex(Cell)];
+	if ((Slot == INDEX_NONE) == (Label == INDEX_NONE))
+	{
+		Slot = Label;
+		return;
+	}
+
+	Slot = Label;
+	if (Label != INDEX_NONE)
+	{
+		++NumLabels;
+		++(*Chunk)->NumLabels;
+	}
+	else
+	{
+		--NumLabels;
+		if (--(*Chunk)->NumLabels == 0)
+		{
+			Chunks.Remove(Key);
+		}
+	}
+}
+
+int32 FESGridRegions::AllocateNode()
+{
+	// Removals leave dead nodes behind, recycle them once they outnumber the cells
+	if (FreeNodes.Num() == 0 && Parents.Num() > NumLabels * 2 + 1024)
+	{
+		Compact();
+	}
+
+	const int32 Node = FreeNodes.Num() > 0 ? FreeNodes.Pop(false) : Parents.Add(0);
+	Sizes.SetNum(Parents.Num());
+	Parents[Node] = Node;
+	Sizes[Node] = 0;
+	return Node;
+}
+
+int32 FESGridRegions::Union(int32 A, int32 B)
+{
+	A = FindRoot(A);
+	B = FindRoot(B);
+	if (A == B)
+	{
+		return A;
+	}
+	if (Sizes[A] < Sizes[B])
+	{
+		Swap(A, B);
+	}
+	Parents[B] = A;
+	Sizes[A] += Sizes[B];
+	Sizes[B] = 0;
+	return A;
+}
+
+void FESGridRegions::AddCell(int32 Layer, FIntPoint Cell, TArray<FGridRegionEvent>* OutEvents)
+{
+	const EGroundType Type = Core->Get(Cell.X, Cell.Y);
+	int32 Region = AllocateNode();
+	Sizes[Region] = 1;
+	SetLabel(Layer, Cell, Region);
+	++NumRegions[Layer];
+
+	int32 Joined[4];
+	int32 NumJoined = 0;
+	for (const FIntPoint& Step : GRegionSteps)
+	{
+		const FIntPoint Next = Cell + Step;
+		const int32 Label = GetLabel(Layer, Next);
+		if (Label == INDEX_NONE || (Layer == TypeLayer && Core->Get(Next.X, Next.Y) != Type))
+		{
+			continue;
+		}
+		const int32 Root = FindRoot(Label);
+		if (Root != Region)
+		{
+			Joined[NumJoined++] = Root;
+			// The existing region wins a tie, so a single cell growing by one keeps its id
+			Region = Union(Root, Region);
+			--NumRegions[Layer];
+		}
+	}
+
+	// Joining a single region is growth, not a merge
+	if (OutEvents && NumJoined >= 2)
+	{
+		FGridRegionEvent& Event = OutEvents->AddDefaulted_GetRef();
+		Event.Type = Layer == TypeLayer ? Type : GroundTypeNone;
+		Event.Region = Region;
+		for (int32 i = 0; i < NumJoined; ++i)
+		{
+			if (Joined[i] != Region)
+			{
+				Event.Others.Add(Joined[i]);
+			}
+		}
+	}
+}
+
+void FESGridRegions::RemoveCell(int32 Layer, FIntPoint Cell, EGroundType Type, TArray<FGridRegionEvent>& OutEvents)
+{
+	const int32 Label = GetLabel(Layer, Cell);
+	if (Label == INDEX_NONE)
+	{
+		return;
+	}
+	const int32 Region = FindRoot(Label);
+	SetLabel(Layer, Cell, INDEX_NONE);
+	if (--Sizes[Region] == 0)
+	{
+		--NumRegions[Layer];
+		return;
+	}
+
+	auto IsMember = [this, Layer, Region](FIntPoint Next)
+	{
+		const int32 NextLabel = GetLabel(Layer, Next);
+		return NextLabel != INDEX_NONE && FindRoot(NextLabel) == Region;
+	};
+
+	// Every remaining neighbour starts a flood fill, fills that meet join one group
+	TArray<FIntPoint> Pieces[4];
+	int32 Heads[4] = {0, 0, 0, 0};
+	int32 Groups[4] = {0, 1, 2, 3};
+	bool bClosed[4] = {false, false, false, false};
+	int32 NumFills = 0;
+	for (const FIntPoint& Step : GRegionSteps)
+	{
+		if (IsMember(Cell + Step))
+		{
+			Pieces[NumFills++].Add(Cell + Step);
+		}
+	}
+	if (NumFills < 2)
+	{
+		return;
+	}
+
+	if (++VisitGeneration == 0)
+	{
+		for (auto& Pair : Chunks)
+		{
+			FMemory::Memzero(Pair.Value->VisitStamps, sizeof(FLabelChunk::VisitStamps));
+		}
+		VisitGeneration = 1;
+	}
+	for (int32 i = 0; i < NumFills; ++i)
+	{
+		FLabelChunk* Chunk = FindChunk(Pieces[i][0]);
+		Chunk->VisitStamps[GetLocalIndex(Pieces[i][0])] = VisitGeneration;
+		Chunk->VisitOwners[GetLocalIndex(Pieces[i][0])] = static_cast<uint8>(i);
+	}
+
+	auto FindGroup = [&Groups](int32 Fill)
+	{
+		while (Groups[Fill] != Fill)
+		{
+			Fill = Groups[Fill];
+		}
+		return Fill;
+	};
+
+	// Fills advance in lockstep, so the work is bounded by the pieces that split off, not the one that stays
+	FGridRegionEvent Event;
+	int32 NumOpen = NumFills;
+	while (NumOpen > 1)
+	{
+		for (int32 i = 0; i < NumFills && NumOpen > 1; ++i)
+		{
+			const int32 Group = FindGroup(i);
+			if (bClosed[Group])
+			{
+				continue;
+			}
+
+			if (Heads[i] == Pieces[i].Num())
+			{
+				bool bExhausted = true;
+				for (int32 j = 0; j < NumFills; ++j)
+				{
+					bExhausted &= FindGroup(j) != Group || Heads[j] == Pieces[j].Num();
+				}
+				if (!bExhausted)
+				{
+					continue;
+				}
+
+				// The group is a whole piece cut off from the rest
+				const int32 Node = AllocateNode();
+				for (int32 j = 0; j < NumFills; ++j)
+				{
+					if (FindGroup(j) == Group)
+					{
+						for (const FIntPoint& PieceCell : Pieces[j])
+						{
+							SetLabel(Layer, PieceCell, Node);
+						}
+						Sizes[Node] += Pieces[j].Num();
+					}
+				}
+				Sizes[Region] -= Sizes[Node];
+				++NumRegions[Layer];
+				Event.Others.Add(Node);
+				bClosed[Group] = true;
+				--NumOpen;
+				continue;
+			}
+
+			const FIntPoint Current = Pieces[i][Heads[i]++];
+			for (const FIntPoint& Step : GRegionSteps)
+			{
+				const FIntPoint Next = Current + Step;
+				FLabelChunk* Chunk = FindChunk(Next);
+				if (!Chunk)
+				{
+					continue;
+				}
+
+				const int32 Local = GetLocalIndex(Next);
+				if (Chunk->VisitStamps[Local] == VisitGeneration)
+				{
+					const int32 Other = FindGroup(Chunk->VisitOwners[Local]);
+					if (Other != Group)
+					{
+						Groups[Other] = Group;
+						--NumOpen;
+					}
+					continue;
+				}
+				if (IsMember(Next))
+				{
+					Chunk->VisitStamps[Local] = VisitGeneration;
+					Chunk->VisitOwners[Local] = static_cast<uint8>(i);
+					Pieces[i].Add(Next);
+				}
+			}
+		}
+	}
+
+	if (Event.Others.Num() > 0)
+	{
+		Event.Type = Type;
+		Event.Region = Region;
+		Event.bSplit = true;
+		OutEvents.Add(MoveTemp(Event));
+	}
+}
+
+void FESGridRegions::Compact()
+{
+	TBitArray<> Live(false, Parents.Num());
+	for (auto& Pair : Chunks)
+	{
+		for (int32 Layer = 0; Layer < 2; ++Layer)
+		{
+			for (int32& Label : Pair.Value->Labels[Layer])
+			{
+				if (Label != INDEX_NONE)
+				{
+					Label = FindRoot(Label);
+					Live[Label] = true;
+				}
+			}
+		}
+	}
+
+	FreeNodes.Reset();
+	for (int32 Node = Parents.Num() - 1; Node >= 0; --Node)
+	{
+		if (!Live[Node])
+		{
+			Parents[Node] = Node;
+			Sizes[Node] = 0;
+			FreeNodes.Add(Node);
+		}
+	}
+}
@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Grid/ESGridStorage.h"
+
+class FESGridCore;
+struct FGridEditBatch;
+
+// One region merge or split caused by a committed edit
+struct FGridRegionEvent
+{
+	// None for regions of any ground, otherwise regions of that one type
+	EGroundType Type = GroundTypeNone;
+
+	// Region that kept its id
+	int32 Region = INDEX_NONE;
+
+	// Regions merged into Region, or split off it
+	TArray<int32> Others;
+
+	bool bSplit = false;
+};
+
+/**
+ * Connected 4-neighbour regions of the grid, of any ground and of each ground type.
+ * Additions join regions through union-find, a removal only walks the pieces around the removed cell.
+ * Region ids stay the same while a region only grows or shrinks, a merge keeps the id of the larger region.
+ */
+class EVEOFTHESTORM_API FESGridRegions
+{
+public:
+	// Label every cell of the grid from scratch
+	void Rebuild(const FESGridCore* InCore);
+
+	// Apply a committed batch, the grid must already hold the new types
+	void Apply(const FGridEditBatch& Batch, TArray<FGridRegionEvent>& OutEvents);
+
+	// Region of a cell, INDEX_NONE for empty cells
+	int32 GetRegion(int32 X, int32 Y, bool bByType) const;
+
+	// Number of cells of a region, 0 for ids that are no region
+	int32 GetRegionSize(int32 Region) const
+	{
+		return Parents.IsValidIndex(Region) && Parents[Region] == Region ? Sizes[Region] : 0;
+	}
+
+	int32 GetNumRegions(bool bByType) const { return NumRegions[bByType ? 1 : 0]; }
+
+private:
+	static constexpr int32 GroundLayer = 0;
+	static constexpr int32 TypeLayer = 1;
+
+	// Labels of one 64x64 block, released once no cell of it is labelled
+	struct FLabelChunk
+	{
+		int32 Labels[2][FESGridStorage::ChunkArea];
+
+		// Flood fill marks, valid when the stamp matches the current generation
+		uint32 VisitStamps[FESGridStorage::ChunkArea];
+
+		uint8 VisitOwners[FESGridStorage::ChunkArea];
+
+		int32 NumLabels = 0;
+	};
+
+	static FORCEINLINE int32 GetLocalIndex(FIntPoint Cell)
+	{
+		return ((Cell.Y & FESGridStorage::ChunkMask) << FESGridStorage::ChunkShift) + (Cell.X & FESGridStorage::ChunkMask);
+	}
+
+	FORCEINLINE FLabelChunk* FindChunk(FIntPoint Cell) const
+	{
+		const TUniquePtr<FLabelChunk>* Chunk = Chunks.Find(FIntPoint(Cell.X >> FESGridStorage::ChunkShift, Cell.Y >> FESGridStorage::ChunkShift));
+		return Chunk ? Chunk->Get() : nullptr;
+	}
+
+	FORCEINLINE int32 GetLabel(int32 Layer, FIntPoint Cell) const
+	{
+		const FLabelChunk* Chunk = FindChunk(Cell);
+		return Chunk ? Chunk->Labels[Layer][GetLocalIndex(Cell)] : INDEX_NONE;
+	}
+
+	void SetLabel(int32 Layer, FIntPoint Cell, int32 Label);
+
+	// Root of a label, halving the path on the way
+	FORCEINLINE int32 FindRoot(int32 Node) const
+	{
+		while (Parents[Node] != Node)
+		{
+			Parents[Node] = Parents[Parents[Node]];
+			Node = Parents[Node];
+		}
+		return Node;
+	}
+
+	int32 AllocateNode();
+
+	// Union by size, returns the surviving root. On a tie A survives
+	int32 Union(int32 A, int32 B);
+
+	void AddCell(int32 Layer, FIntPoint Cell, TArray<FGridRegionEvent>* OutEvents);
+
+	void RemoveCell(int32 Layer, FIntPoint Cell, EGroundType Type, TArray<FGridRegionEvent>& OutEvents);
+
+	// Point every label at its root and recycle the nodes nothing points at anymore
+	void Compact();
+
+	const FESGridCore* Core = nullptr;
+
+	TMap<FIntPoint, TUniquePtr<FLabelChunk>> Chunks;
+
+	// Union-find forest, roots are region ids
+	mutable TArray<int32> Parents;
+
+	// Cell count of each root
+	TArray<int32> Sizes;
+
+	TArray<int32> FreeNodes;
+
+	int32 NumRegions[2] = {0, 0};
+
+	int32 NumLabels = 0;
+
+	uint32 VisitGeneration = 0;
+};
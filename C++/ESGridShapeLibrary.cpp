@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridShapeLibrary.cpp#
+ * Author: Yuyang Qiu
+ * Function:Cache the rotations and footprints of every tile shape used on the grid.
+ */
+
+#include "Core/Grid/ESGridShapeLibrary.h"
+
+#include <atomic>
+
+FESGridShapeLibrary::FESGridShapeLibrary()
+{
+	static std::atomic<uint32> NextId(1);
+	Id = NextId++;
+}
+
+FESGridShapeHandle FESGridShapeLibrary::Register(const TArray<FIntPoint>& Shape)
+{
+	FESGridShapeHandle Handle = Find(Shape);
+	if (Handle.IsValid())
+	{
+		return Handle;
+	}
+
+	TUniquePtr<FGridShape> NewShape = MakeUnique<FGridShape>();
+	NewShape->Shape = Shape;
+	for (const auto p : Shape)
+	{
+		NewShape->Size.X = FMath::Max(NewShape->Size.X, p.X);
+		NewShape->Size.Y = FMath::Max(NewShape->Size.Y, p.Y);
+	}
+
+	for (int32 i = 0; i < GridDirectionCount; ++i)
+	{
+		FGridShapeRotation& Rotation = NewShape->Rotations[i];
+		const EGridDirection Direction = static_cast<EGridDirection>(i);
+		Rotation.Cells = Rotator ? Rotator(Shape, Direction) : RotateQuarterTurns(Shape, Direction);
+		if (Rotation.Cells.Num() == 0)
+		{
+			continue;
+		}
+
+		Rotation.Min = Rotation.Cells[0];
+		Rotation.Max = Rotation.Cells[0];
+		for (const auto p : Rotation.Cells)
+		{
+			Rotation.Min = Rotation.Min.ComponentMin(p);
+			Rotation.Max = Rotation.Max.ComponentMax(p);
+		}
+
+		// Shapes come from Blueprint and assets, a bad one is refused instead of taking the game down
+		if (!ensureMsgf(Rotation.GetWidth() <= MaxShapeWidth, TEXT("Grid shapes wider than %d cells are not supported"), MaxShapeWidth))
+		{
+			return FESGridShapeHandle();
+		}
+		Rotation.RowMasks.SetNumZeroed(Rotation.GetHeight());
+		for (const auto p : Rotation.Cells)
+		{
+			Rotation.RowMasks[p.Y - Rotation.Min.Y] |= uint64(1) << (p.X - Rotation.Min.X);
+		}
+	}
+
+	Handle.Index = Shapes.Add(MoveTemp(NewShape));
+	Handle.Library = Id;
+	ShapesByHash.Add(HashShape(Shape), Handle.Index);
+	return Handle;
+}
+
+FESGridShapeHandle FESGridShapeLibrary::Find(const TArray<FIntPoint>& Shape) const
+{
+	FESGridShapeHandle Handle;
+	for (auto It = ShapesByHash.CreateConstKeyIterator(HashShape(Shape)); It; ++It)
+	{
+		if (Shapes[It.Value()]->Shape == Shape)
+		{
+			Handle.Index = It.Value();
+			Handle.Library = Id;
+			break;
+		}
+	}
+	return Handle;
+}
+
+uint32 FESGridShapeLibrary::HashShape(const TArray<FIntPoint>& Shape)
+{
+	uint32 Hash = GetTypeHash(Shape.Num());
+	for (const auto p : Shape)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(p));
+	}
+	return Hash;
+}
+
+TArray<FIntPoint> FESGridShapeLibrary::RotateQuarterTurns(const TArray<FIntPoint>& Shape, EGridDirection Direction)
+{
+	TArray<FIntPoint> Result;
+	Result.Reserve(Shape.Num());
+	const int32 Turns = static_cast<int32>(Direction) % GridDirectionCount;
+	for (FIntPoint p : Shape)
+	{
+		for (int32 i = 0; i < Turns; ++i)
+		{
+			p = FIntPoint(-p.Y, p.X);
+		}
+		Result.Add(p);
+	}
+	return Result;
+}
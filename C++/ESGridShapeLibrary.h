@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Grid/ESGridCoreTypes.h"
+
+// Mirrored for Blueprint by FGridShapeHandle
+struct FESGridShapeHandle
+{
+	int32 Index = INDEX_NONE;
+
+	// Library that issued the handle, 0 for handles built by hand
+	uint32 Library = 0;
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+
+	friend uint32 GetTypeHash(const FESGridShapeHandle& Handle)
+	{
+		return GetTypeHash(Handle.Index);
+	}
+
+	bool operator==(const FESGridShapeHandle& Other) const
+	{
+		return Index == Other.Index && Library == Other.Library;
+	}
+};
+
+// Offsets of a shape turned towards Direction, North returns them unchanged
+using FESGridShapeRotator = TFunction<TArray<FIntPoint>(const TArray<FIntPoint>& Shape, EGridDirection Direction)>;
+
+/**
+ * One rotation of a registered shape, precomputed once.
+ */
+struct FGridShapeRotation
+{
+	// Offsets in the order the rotator returns them
+	TArray<FIntPoint> Cells;
+
+	// Inclusive bounds of the offsets
+	FIntPoint Min = FIntPoint::ZeroValue;
+
+	FIntPoint Max = FIntPoint::ZeroValue;
+
+	// One word per row from Min.Y to Max.Y, bit i set when column Min.X + i is covered
+	TArray<uint64> RowMasks;
+
+	int32 GetWidth() const { return Max.X - Min.X + 1; }
+
+	int32 GetHeight() const { return Max.Y - Min.Y + 1; }
+};
+
+struct FGridShape
+{
+	TArray<FIntPoint> Shape;
+
+	// Same value as FGridTile::GetSize
+	FIntPoint Size = FIntPoint::ZeroValue;
+
+	FGridShapeRotation Rotations[GridDirectionCount];
+
+	FORCEINLINE const FGridShapeRotation& GetRotation(EGridDirection Direction) const
+	{
+		return Rotations[static_cast<int32>(Direction) % GridDirectionCount];
+	}
+};
+
+/**
+ * Interns tile shapes so rotations, bounds and footprints are built once.
+ * Registered shapes are never removed, so handles and references stay valid.
+ */
+class EVEOFTHESTORM_API FESGridShapeLibrary
+{
+public:
+	FESGridShapeLibrary();
+
+	/**
+	 * Replace the quarter turn rotation, the grid system plugs UESGridHelper::RotateShape in.
+	 * Only shapes registered afterwards use it.
+	 */
+	void SetRotator(FESGridShapeRotator InRotator) { Rotator = MoveTemp(InRotator); }
+
+	// Row masks are one word per row
+	static constexpr int32 MaxShapeWidth = 64;
+
+	// Returns an invalid handle for shapes wider than MaxShapeWidth in any direction
+	FESGridShapeHandle Register(const TArray<FIntPoint>& Shape);
+
+	// Lookup only, does not allocate
+	FESGridShapeHandle Find(const TArray<FIntPoint>& Shape) const;
+
+	// False for default handles and handles of another library
+	bool IsValid(FESGridShapeHandle Handle) const { return Handle.Library == Id && Shapes.IsValidIndex(Handle.Index); }
+
+	FORCEINLINE const FGridShape& Get(FESGridShapeHandle Handle) const
+	{
+		check(IsValid(Handle));
+		return *Shapes[Handle.Index];
+	}
+
+	int32 Num() const { return Shapes.Num(); }
+
+private:
+	static uint32 HashShape(const TArray<FIntPoint>& Shape);
+
+	// Default rotation, each direction turns the shape a quarter further clockwise
+	static TArray<FIntPoint> RotateQuarterTurns(const TArray<FIntPoint>& Shape, EGridDirection Direction);
+
+	uint32 Id = 0;
+
+	FESGridShapeRotator Rotator;
+
+	TArray<TUniquePtr<FGridShape>> Shapes;
+
+	TMultiMap<uint32, int32> ShapesByHash;
+};
@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridSnapshot.cpp#
+ * Author: Yuyang Qiu
+ * Function:Read-only grid queries for worker threads.
+ */
+
+#include "Core/Grid/ESGridSnapshot.h"
+
+#include "Core/Grid/ESGridCore.h"
+
+int32 FESGridSnapshot::GetNeighbourCount(int32 X, int32 Y) const
+{
+	if (!IsValid(X, Y))
+	{
+		return 0;
+	}
+	return static_cast<int32>(GetOccupiedBits(X - 1, Y) & 1) + static_cast<int32>(GetOccupiedBits(X + 1, Y) & 1)
+		+ static_cast<int32>(GetOccupiedBits(X, Y - 1) & 1) + static_cast<int32>(GetOccupiedBits(X, Y + 1) & 1);
+}
+
+bool FESGridSnapshot::HasShape(int32 X, int32 Y, const FGridShapeRotation& Shape) const
+{
+	bool bOverlaps;
+	bool bTouches;
+	TestShape(X, Y, Shape, bOverlaps, bTouches);
+	return !bTouches || bOverlaps;
+}
+
+bool FESGridSnapshot::CanPlaceShape(int32 X, int32 Y, const FGridShapeRotation& Shape) const
+{
+	bool bOverlaps;
+	bool bTouches;
+	TestShape(X, Y, Shape, bOverlaps, bTouches);
+	if (!bTouches)
+	{
+		return false;
+	}
+	return IsValid(X + Shape.Min.X, Y + Shape.Min.Y) && IsValid(X + Shape.Max.X, Y + Shape.Max.Y);
+}
+
+void FESGridSnapshot::TestShape(int32 X, int32 Y, const FGridShapeRotation& Shape, bool& bOutOverlaps, bool& bOutTouches) const
+{
+	const int32 Left = X + Shape.Min.X;
+	const int32 Top = Y + Shape.Min.Y;
+	uint64 OverlapBits = 0;
+	uint64 TouchBits = 0;
+	for (int32 Row = 0; Row < Shape.RowMasks.Num(); ++Row)
+	{
+		OverlapBits |= GetOccupiedBits(Left, Top + Row) & Shape.RowMasks[Row];
+		TouchBits |= GetAdjacentBits(Left, Top + Row) & Shape.RowMasks[Row];
+	}
+	bOutOverlaps = OverlapBits != 0;
+	bOutTouches = TouchBits != 0;
+}
+
+void FESGridSnapshot::FindPlacements(const FGridShape& Shape, bool bRanked, TArray<FESGridPlacement>& OutPlacements) const
+{
+	if (Blocks.Num() == 0)
+	{
+		return;
+	}
+
+	// A valid footprint touches ground, so it overlaps the blocks
+	FIntRect Anchors[GridDirectionCount];
+	int32 MinY = MAX_int32;
+	int32 MaxY = MIN_int32;
+	for (int32 i = 0; i < GridDirectionCount; ++i)
+	{
+		const FGridShapeRotation& Rotation = Shape.Rotations[i];
+		if (Rotation.Cells.Num() == 0)
+		{
+			continue;
+		}
+
+		FIntRect& Range = Anchors[i];
+		Range = FIntRect(Bounds.Min - Rotation.Min, Bounds.Max - Rotation.Max);
+		Range.Clip(FIntRect(BlockBounds.Min - Rotation.Max, BlockBounds.Max - Rotation.Min));
+		if (Range.Width() > 0 && Range.Height() > 0)
+		{
+			MinY = FMath::Min(MinY, Range.Min.Y);
+			MaxY = FMath::Max(MaxY, Range.Max.Y);
+		}
+	}
+
+	for (int32 Y = MinY; Y < MaxY; ++Y)
+	{
+		for (int32 i = 0; i < GridDirectionCount; ++i)
+		{
+			const FIntRect& Range = Anchors[i];
+			if (Y < Range.Min.Y || Y >= Range.Max.Y || Range.Min.X >= Range.Max.X)
+			{
+				continue;
+			}
+
+			// Skip the band quickly when no footprint row can touch ground
+			const FGridShapeRotation& Rotation = Shape.Rotations[i];
+			const int32 FirstWord = (Range.Min.X + Rotation.Min.X) >> 6;
+			const int32 LastWord = (Range.Max.X - 1 + Rotation.Max.X) >> 6;
+			uint64 Band = 0;
+			for (int32 Row = Y + Rotation.Min.Y; Row <= Y + Rotation.Max.Y; ++Row)
+			{
+				for (int32 Word = FirstWord; Word <= LastWord; ++Word)
+				{
+					Band |= GetWord(Word, Row, true);
+				}
+			}
+			if (Band == 0)
+			{
+				continue;
+			}
+
+			for (int32 X = Range.Min.X; X < Range.Max.X; ++X)
+			{
+				bool bOverlaps;
+				bool bTouches;
+				TestShape(X, Y, Rotation, bOverlaps, bTouches);
+				if (bTouches && !bOverlaps)
+				{
+					FESGridPlacement& Placement = OutPlacements.AddDefaulted_GetRef();
+					Placement.X = X;
+					Placement.Y = Y;
+					Placement.Direction = static_cast<EGridDirection>(i);
+					if (bRanked)
+					{
+						for (int32 Row = 0; Row < Rotation.RowMasks.Num(); ++Row)
+						{
+							Placement.Score += FMath::CountBits(GetAdjacentBits(X + Rotation.Min.X, Y + Rotation.Min.Y + Row) & Rotation.RowMasks[Row]);
+						}
+					}
+				}
+			}
+		}
+	}
+}
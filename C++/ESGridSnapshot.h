@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Grid/ESGridStorage.h"
+#include "Core/Grid/ESGridShapeLibrary.h"
+
+struct FESGridPlacement;
+
+// Cells and bitboard rows of one 64x64 block, never changed once published
+struct FGridSnapshotBlock
+{
+	EGroundType Cells[FESGridStorage::ChunkArea];
+
+	uint64 Occupied[FESGridStorage::ChunkSize];
+
+	uint64 Adjacent[FESGridStorage::ChunkSize];
+};
+
+/**
+ * Immutable view of the grid at one edit version, safe to read from any thread.
+ * Blocks are shared between snapshots until an edit touches them, blocks without ground or adjacency are absent.
+ */
+class EVEOFTHESTORM_API FESGridSnapshot
+{
+public:
+	typedef TSharedRef<const FGridSnapshotBlock, ESPMode::ThreadSafe> FBlockRef;
+
+	int32 GetEditVersion() const { return EditVersion; }
+
+	int32 GetNumBlocks() const { return Blocks.Num(); }
+
+	FORCEINLINE bool IsValid(int32 X, int32 Y) const { return Bounds.Contains(FIntPoint(X, Y)); }
+
+	FORCEINLINE EGroundType Get(int32 X, int32 Y) const
+	{
+		const FGridSnapshotBlock* Block = FindBlock(X >> FESGridStorage::ChunkShift, Y >> FESGridStorage::ChunkShift);
+		return Block ? Block->Cells[((Y & FESGridStorage::ChunkMask) << FESGridStorage::ChunkShift) + (X & FESGridStorage::ChunkMask)]
+		             : GroundTypeNone;
+	}
+
+	bool IsPointNearGround(int32 X, int32 Y) const { return (GetAdjacentBits(X, Y) & 1) != 0; }
+
+	// Non-empty 4-neighbours of a cell
+	int32 GetNeighbourCount(int32 X, int32 Y) const;
+
+	// 64 bits of row Y starting at column X, like FESGridBitboard::GetBits
+	uint64 GetOccupiedBits(int32 X, int32 Y) const { return GetBits(X, Y, false); }
+
+	uint64 GetAdjacentBits(int32 X, int32 Y) const { return GetBits(X, Y, true); }
+
+	// Same rules as FESGridCore::HasShape and FESGridCore::CanPlaceShape
+	bool HasShape(int32 X, int32 Y, const FGridShapeRotation& Shape) const;
+
+	bool CanPlaceShape(int32 X, int32 Y, const FGridShapeRotation& Shape) const;
+
+	/**
+	 * Every anchor and direction where the shape can be placed, in row order.
+	 * Shape must stay alive during the call, entries of the shape library always do.
+	 */
+	void FindPlacements(const FGridShape& Shape, bool bRanked, TArray<FESGridPlacement>& OutPlacements) const;
+
+private:
+	friend class FESGridCore;
+
+	FORCEINLINE const FGridSnapshotBlock* FindBlock(int32 BlockX, int32 BlockY) const
+	{
+		const FBlockRef* Block = Blocks.Find(FIntPoint(BlockX, BlockY));
+		return Block ? &Block->Get() : nullptr;
+	}
+
+	FORCEINLINE uint64 GetWord(int32 WordX, int32 Y, bool bAdjacent) const
+	{
+		const FGridSnapshotBlock* Block = FindBlock(WordX, Y >> FESGridStorage::ChunkShift);
+		if (!Block)
+		{
+			return 0;
+		}
+		return bAdjacent ? Block->Adjacent[Y & FESGridStorage::ChunkMask] : Block->Occupied[Y & FESGridStorage::ChunkMask];
+	}
+
+	FORCEINLINE uint64 GetBits(int32 X, int32 Y, bool bAdjacent) const
+	{
+		const int32 WordX = X >> 6;
+		const int32 Shift = X & 63;
+		const uint64 Low = GetWord(WordX, Y, bAdjacent) >> Shift;
+		return Shift == 0 ? Low : Low | (GetWord(WordX + 1, Y, bAdjacent) << (64 - Shift));
+	}
+
+	// Overlap and touch test of a footprint, row by row
+	void TestShape(int32 X, int32 Y, const FGridShapeRotation& Shape, bool& bOutOverlaps, bool& bOutTouches) const;
+
+	TMap<FIntPoint, FBlockRef> Blocks;
+
+	// Valid positions, max exclusive
+	FIntRect Bounds;
+
+	// Cells covered by the blocks, max exclusive
+	FIntRect BlockBounds;
+
+	int32 EditVersion = 0;
+};
+
+typedef TSharedRef<const FESGridSnapshot, ESPMode::ThreadSafe> FESGridSnapshotRef;
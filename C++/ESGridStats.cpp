@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridStats.cpp#
+ * Author: Yuyang Qiu
+ * Function:Frame histograms of the grid hot paths and their CSV export.
+ */
+
+#include "Core/Grid/ESGridStats.h"
+
+#if ES_GRID_STATS
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_STAT(STAT_ESGrid_HasShape);
+DEFINE_STAT(STAT_ESGrid_CanPlaceShape);
+DEFINE_STAT(STAT_ESGrid_SetShape);
+DEFINE_STAT(STAT_ESGrid_FindPlacements);
+DEFINE_STAT(STAT_ESGrid_BroadcastBatch);
+DEFINE_STAT(STAT_ESGrid_AddInstances);
+DEFINE_STAT(STAT_ESGrid_RemoveInstances);
+DEFINE_STAT(STAT_ESGrid_UpdatePreview);
+DEFINE_STAT(STAT_ESGrid_FindPath);
+
+static const TCHAR* GESGridStatNames[] =
+{
+	TEXT("HasShape"),
+	TEXT("CanPlaceShape"),
+	TEXT("SetShape"),
+	TEXT("FindPlacements"),
+	TEXT("BroadcastBatch"),
+	TEXT("AddInstances"),
+	TEXT("RemoveInstances"),
+	TEXT("UpdatePreview"),
+	TEXT("FindPath"),
+};
+static_assert(UE_ARRAY_COUNT(GESGridStatNames) == static_cast<int32>(EESGridStat::Count), "Missing grid stat name");
+
+static FAutoConsoleCommand GESGridStatsDumpCommand(
+	TEXT("ESGrid.Stats.Dump"),
+	TEXT("Write the grid hot path histograms to a CSV file. Optional argument: file path."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const FString Path = Args.Num() > 0 ? Args[0] : FPaths::ProfilingDir() / TEXT("ESGridStats.csv");
+		if (FESGridStats::Get().WriteCsv(Path))
+		{
+			UE_LOG(LogTemp, Log, TEXT("Grid stats written to %s"), *Path);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Grid stats could not be written to %s"), *Path);
+		}
+	}));
+
+static FAutoConsoleCommand GESGridStatsResetCommand(
+	TEXT("ESGrid.Stats.Reset"),
+	TEXT("Clear the grid hot path histograms."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FESGridStats::Get().Reset();
+	}));
+
+FESGridStats& FESGridStats::Get()
+{
+	static FESGridStats Stats;
+	return Stats;
+}
+
+FESGridStats::FESGridStats()
+{
+	FCoreDelegates::OnEndFrame.AddRaw(this, &FESGridStats::EndFrame);
+}
+
+int32 FESGridStats::GetBucket(uint64 Value)
+{
+	return Value == 0 ? 0 : FMath::Min(static_cast<int32>(FMath::FloorLog2_64(Value)) + 1, NumBuckets - 1);
+}
+
+void FESGridStats::EndFrame()
+{
+	for (int32 i = 0; i < static_cast<int32>(EESGridStat::Count); ++i)
+	{
+		const uint64 Calls = Frame[i].Calls.exchange(0, std::memory_order_relaxed);
+		const uint64 Cycles = Frame[i].Cycles.exchange(0, std::memory_order_relaxed);
+
+		FHistory& Entry = History[i];
+		++Entry.Frames;
+		Entry.Calls += Calls;
+		Entry.Cycles += Cycles;
+		Entry.MaxCalls = FMath::Max(Entry.MaxCalls, Calls);
+		Entry.MaxCycles = FMath::Max(Entry.MaxCycles, Cycles);
+		++Entry.CallBuckets[GetBucket(Calls)];
+		++Entry.TimeBuckets[GetBucket(static_cast<uint64>(FPlatformTime::ToMilliseconds64(Cycles) * 1000.0))];
+	}
+}
+
+void FESGridStats::Reset()
+{
+	for (int32 i = 0; i < static_cast<int32>(EESGridStat::Count); ++i)
+	{
+		Frame[i].Calls.store(0, std::memory_order_relaxed);
+		Frame[i].Cycles.store(0, std::memory_order_relaxed);
+		History[i] = FHistory();
+	}
+}
+
+bool FESGridStats::WriteCsv(const FString& Path) const
+{
+	FString Csv = TEXT("Stat,Frames,Calls,TotalMs,CallsPerFrame,MsPerFrame,MaxCallsPerFrame,MaxMsPerFrame");
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		Csv += FString::Printf(Bucket + 1 < NumBuckets ? TEXT(",CallsLt%llu") : TEXT(",CallsGe%llu"), 1ull << (Bucket + 1 < NumBuckets ? Bucket : Bucket - 1));
+	}
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		Csv += FString::Printf(Bucket + 1 < NumBuckets ? TEXT(",UsLt%llu") : TEXT(",UsGe%llu"), 1ull << (Bucket + 1 < NumBuckets ? Bucket : Bucket - 1));
+	}
+	Csv += LINE_TERMINATOR;
+
+	for (int32 i = 0; i < static_cast<int32>(EESGridStat::Count); ++i)
+	{
+		const FHistory& Entry = History[i];
+		const double TotalMs = FPlatformTime::ToMilliseconds64(Entry.Cycles);
+		const double Frames = FMath::Max<double>(Entry.Frames, 1);
+		Csv += FString::Printf(TEXT("%s,%llu,%llu,%.4f,%.2f,%.4f,%llu,%.4f"), GESGridStatNames[i], Entry.Frames, Entry.Calls,
+		                       TotalMs, Entry.Calls / Frames, TotalMs / Frames, Entry.MaxCalls,
+		                       FPlatformTime::ToMilliseconds64(Entry.MaxCycles));
+		for (const uint32 Count : Entry.CallBuckets)
+		{
+			Csv += FString::Printf(TEXT(",%u"), Count);
+		}
+		for (const uint32 Count : Entry.TimeBuckets)
+		{
+			Csv += FString::Printf(TEXT(",%u"), Count);
+		}
+		Csv += LINE_TERMINATOR;
+	}
+	return FFileHelper::SaveStringToFile(Csv, *Path);
+}
+
+#endif
@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+#include <atomic>
+
+// Set to 0 to compile every grid timer and counter out
+#ifndef ES_GRID_STATS
+#define ES_GRID_STATS !UE_BUILD_SHIPPING
+#endif
+
+// Instrumented grid paths, one counter and histogram each
+enum class EESGridStat : uint8
+{
+	HasShape,
+	CanPlaceShape,
+	SetShape,
+	FindPlacements,
+	BroadcastBatch,
+	AddInstances,
+	RemoveInstances,
+	UpdatePreview,
+	FindPath,
+	Count
+};
+
+#if ES_GRID_STATS
+
+DECLARE_STATS_GROUP(TEXT("ES Grid"), STATGROUP_ESGrid, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("HasShape"), STAT_ESGrid_HasShape, STATGROUP_ESGrid, EVEOFTHESTORM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("CanPlaceShape"), STAT_ESGrid_CanPlaceShape, STATGROUP_ESGrid, EVEOFTHESTORM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SetShape"), STAT_ESGrid_SetShape, STATGROUP_ESGrid, EVEOFTHESTORM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("FindPlacements"), STAT_ESGrid_FindPlacements, STATGROUP_ESGrid, EVEOFTHESTORM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("BroadcastBatch"), STAT_ESGrid_BroadcastBatch, STATGROUP_ESGrid, EVEOFTHESTORM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AddInstances"), STAT_ESGrid_AddInstances, STATGROUP_ESGrid, EVEOFTHESTORM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("RemoveInstances"), STAT_ESGrid_RemoveInstances, STATGROUP_ESGrid, EVEOFTHESTORM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdatePreview"), STAT_ESGrid_UpdatePreview, STATGROUP_ESGrid, EVEOFTHESTORM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("FindPath"), STAT_ESGrid_FindPath, STATGROUP_ESGrid, EVEOFTHESTORM_API);
+
+/**
+ * Per-frame call counts and times of the grid hot paths.
+ * Every frame is folded into log2 histograms, ESGrid.Stats.Dump writes them to CSV.
+ */
+class EVEOFTHESTORM_API FESGridStats
+{
+public:
+	static FESGridStats& Get();
+
+	// Safe from any thread
+	FORCEINLINE void Add(EESGridStat Stat, uint64 Cycles)
+	{
+		FFrameCounter& Counter = Frame[static_cast<int32>(Stat)];
+		Counter.Calls.fetch_add(1, std::memory_order_relaxed);
+		Counter.Cycles.fetch_add(Cycles, std::memory_order_relaxed);
+	}
+
+	// Fold the current frame into the histograms, called at the end of every engine frame
+	void EndFrame();
+
+	void Reset();
+
+	bool WriteCsv(const FString& Path) const;
+
+private:
+	FESGridStats();
+
+	// Bucket 0 holds 0, bucket i holds [2^(i-1), 2^i), the last one is open
+	static constexpr int32 NumBuckets = 20;
+
+	static int32 GetBucket(uint64 Value);
+
+	struct FFrameCounter
+	{
+		std::atomic<uint64> Calls{0};
+
+		std::atomic<uint64> Cycles{0};
+	};
+
+	struct FHistory
+	{
+		uint64 Frames = 0;
+
+		uint64 Calls = 0;
+
+		uint64 Cycles = 0;
+
+		uint64 MaxCalls = 0;
+
+		uint64 MaxCycles = 0;
+
+		// Calls per frame
+		uint32 CallBuckets[NumBuckets] = {};
+
+		// Microseconds per frame
+		uint32 TimeBuckets[NumBuckets] = {};
+	};
+
+	FFrameCounter Frame[static_cast<int32>(EESGridStat::Count)];
+
+	FHistory History[static_cast<int32>(EESGridStat::Count)];
+};
+
+// Times the rest of the scope for the stat system, Unreal Insights and the CSV histograms
+struct FESGridStatScope
+{
+	explicit FESGridStatScope(EESGridStat InStat) : Stat(InStat), StartCycles(FPlatformTime::Cycles64())
+	{
+	}
+
+	~FESGridStatScope()
+	{
+		FESGridStats::Get().Add(Stat, FPlatformTime::Cycles64() - StartCycles);
+	}
+
+private:
+	EESGridStat Stat;
+
+	uint64 StartCycles;
+};
+
+#define ES_GRID_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_ESGrid_##Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(ESGrid_##Name); \
+	FESGridStatScope ESGridStatScope_##Name(EESGridStat::Name)
+
+#else
+
+#define ES_GRID_SCOPE(Name)
+
+#endif
@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridStorage.cpp#
+ * Author: Yuyang Qiu
+ * Function:Flat or chunked storage of the ground types used by the grid system.
+ */
+
+#include "Core/Grid/ESGridStorage.h"
+
+int64 FESGridStorage::GetDenseCapacity(int32 InWidth, int32 InHeight, EESGridStorageLayout InLayout)
+{
+	switch (InLayout)
+	{
+	case EESGridStorageLayout::RowMajor:
+		return static_cast<int64>(InWidth) * InHeight;
+	case EESGridStorageLayout::Tiled:
+		return static_cast<int64>(FMath::DivideAndRoundUp(InWidth, TileSize)) * FMath::DivideAndRoundUp(InHeight, TileSize) * TileArea;
+	default:
+		return 0;
+	}
+}
+
+bool FESGridStorage::IsSupported(int32 InWidth, int32 InHeight, EESGridStorageLayout InLayout, EESGridBoundsMode InBoundsMode)
+{
+	if (InWidth < 0 || InHeight < 0 || InWidth > MaxSize || InHeight > MaxSize)
+	{
+		return false;
+	}
+	if (InBoundsMode == EESGridBoundsMode::Unbounded && InLayout != EESGridStorageLayout::Chunked)
+	{
+		return false;
+	}
+	return GetDenseCapacity(InWidth, InHeight, InLayout) <= MAX_int32;
+}
+
+void FESGridStorage::Initialize(int32 InWidth, int32 InHeight, EESGridStorageLayout InLayout,
+                                EESGridBoundsMode InBoundsMode)
+{
+	checkf(InWidth <= MaxSize && InHeight <= MaxSize, TEXT("Grid size %dx%d is above the maximum of %d"), InWidth, InHeight, MaxSize);
+
+	Width = FMath::Max(InWidth, 0);
+	Height = FMath::Max(InHeight, 0);
+	Layout = InLayout;
+	// Dense layouts cannot address cells outside the box
+	BoundsMode = Layout == EESGridStorageLayout::Chunked ? InBoundsMode : EESGridBoundsMode::Fixed;
+	TilesX = FMath::DivideAndRoundUp(Width, TileSize);
+	TilesY = FMath::DivideAndRoundUp(Height, TileSize);
+
+	ChunkSlots.Empty();
+	SlotChunks.Empty();
+	SlotRefs.Empty();
+	FreeSlots.Empty();
+
+	// Chunks are added on demand
+	const int32 Capacity = static_cast<int32>(GetDenseCapacity(Width, Height, Layout));
+
+	// One allocation for the whole grid
+	Cells.Empty(Capacity);
+	Cells.SetNumUninitialized(Capacity);
+	Reset();
+}
+
+void FESGridStorage::Reset()
+{
+	if (IsChunked())
+	{
+		Cells.Empty();
+		ChunkSlots.Empty();
+		SlotChunks.Empty();
+		SlotRefs.Empty();
+		FreeSlots.Empty();
+		return;
+	}
+	FMemory::Memset(Cells.GetData(), static_cast<uint8>(GroundTypeNone), Cells.Num() * sizeof(EGroundType));
+}
+
+FIntRect FESGridStorage::GetValidBounds() const
+{
+	if (BoundsMode == EESGridBoundsMode::Unbounded)
+	{
+		return FIntRect(-UnboundedExtent, -UnboundedExtent, UnboundedExtent, UnboundedExtent);
+	}
+	return FIntRect(0, 0, Width, Height);
+}
+
+int32 FESGridStorage::FindOrAddIndex(int32 X, int32 Y)
+{
+	if (!IsChunked())
+	{
+		return ToIndex(X, Y);
+	}
+
+	const FIntPoint Chunk(X >> ChunkShift, Y >> ChunkShift);
+	if (const int32* Slot = ChunkSlots.Find(Chunk))
+	{
+		return ChunkIndex(*Slot, X, Y);
+	}
+
+	// Reuse a released slot before growing, its cells are already None
+	int32 Slot;
+	if (FreeSlots.Num() > 0)
+	{
+		Slot = FreeSlots.Pop(false);
+		SlotChunks[Slot] = Chunk;
+	}
+	else
+	{
+		Slot = SlotChunks.Add(Chunk);
+		SlotRefs.Add(0);
+		Cells.AddZeroed(ChunkArea);
+	}
+	ChunkSlots.Add(Chunk, Slot);
+	return ChunkIndex(Slot, X, Y);
+}
+
+FIntPoint FESGridStorage::ToPoint(int32 Index) const
+{
+	switch (Layout)
+	{
+	case EESGridStorageLayout::RowMajor:
+		return FIntPoint(Index % Width, Index / Width);
+	case EESGridStorageLayout::Tiled:
+		{
+			const int32 Tile = Index / TileArea;
+			const int32 Local = Index % TileArea;
+			return FIntPoint((Tile % TilesX) * TileSize + (Local & TileMask),
+			                 (Tile / TilesX) * TileSize + (Local >> TileShift));
+		}
+	default:
+		{
+			const int32 Local = Index & (ChunkArea - 1);
+			return SlotChunks[Index / ChunkArea] * ChunkSize + FIntPoint(Local & ChunkMask, Local >> ChunkShift);
+		}
+	}
+}
+
+void FESGridStorage::Retain(int32 Index)
+{
+	if (IsChunked())
+	{
+		++SlotRefs[Index / ChunkArea];
+	}
+}
+
+void FESGridStorage::Release(int32 Index)
+{
+	if (!IsChunked())
+	{
+		return;
+	}
+
+	const int32 Slot = Index / ChunkArea;
+	check(SlotRefs[Slot] > 0);
+	if (--SlotRefs[Slot] == 0)
+	{
+		ChunkSlots.Remove(SlotChunks[Slot]);
+		FreeSlots.Add(Slot);
+	}
+}
+
+void FESGridStorage::ReadChunk(int32 ChunkX, int32 ChunkY, EGroundType* OutCells) const
+{
+	const int32 BaseX = ChunkX * ChunkSize;
+	const int32 BaseY = ChunkY * ChunkSize;
+	for (int32 Row = 0; Row < ChunkSize; ++Row, OutCells += ChunkSize)
+	{
+		// Rows of row-major and chunked layouts are contiguous when fully inside the grid
+		const int32 Y = BaseY + Row;
+		if (Layout != EESGridStorageLayout::Tiled && IsValid(BaseX, Y) && IsValid(BaseX + ChunkSize - 1, Y))
+		{
+			const int32 Index = ToIndex(BaseX, Y);
+			for (int32 X = 0; X < ChunkSize; ++X)
+			{
+				OutCells[X] = Index == INDEX_NONE ? GroundTypeNone : GetAt(Index + X);
+			}
+			continue;
+		}
+
+		for (int32 X = 0; X < ChunkSize; ++X)
+		{
+			OutCells[X] = Get(BaseX + X, Y);
+		}
+	}
+}
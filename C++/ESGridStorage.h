@@ -0,0 +1,277 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Grid/ESGridCoreTypes.h"
+
+// Mirrored for Blueprint by EGridStorageLayout
+enum class EESGridStorageLayout : uint8
+{
+	// Cells stored row by row, X changes fastest.
+	RowMajor,
+	// Cells grouped in 8x8 blocks so a cell and its neighbours share one or two cache lines.
+	Tiled,
+	// 64x64 chunks allocated on first use and released once nothing references them.
+	Chunked
+};
+
+// Mirrored for Blueprint by EGridBoundsMode
+enum class EESGridBoundsMode : uint8
+{
+	// Positions inside [0, Width) x [0, Height) are valid.
+	Fixed,
+	// Every position is valid, negative ones included. Needs the chunked layout.
+	Unbounded
+};
+
+/**
+ * Backing store of the ground types of a grid.
+ * Dense layouts use one allocation for the whole map, the chunked layout only allocates touched chunks.
+ * Every cell has a storage index, which the grid system also uses to address its per-cell tables.
+ */
+struct EVEOFTHESTORM_API FESGridStorage
+{
+public:
+	static constexpr int32 TileShift = 3;
+	static constexpr int32 TileSize = 1 << TileShift;
+	static constexpr int32 TileMask = TileSize - 1;
+	static constexpr int32 TileArea = TileSize * TileSize;
+
+	// One chunk row is exactly one bitboard word
+	static constexpr int32 ChunkShift = 6;
+	static constexpr int32 ChunkSize = 1 << ChunkShift;
+	static constexpr int32 ChunkMask = ChunkSize - 1;
+	static constexpr int32 ChunkArea = ChunkSize * ChunkSize;
+
+	// Half extent of the valid box reported for unbounded grids
+	static constexpr int32 UnboundedExtent = 1 << 29;
+
+	/**
+	 * Largest width or height. Storage indices and every per-cell table are int32,
+	 * a MaxSize x MaxSize dense grid is 1 << 30 cells, tile padding included.
+	 */
+	static constexpr int32 MaxSize = 1 << 15;
+
+	// Cells allocated up front by a dense layout, 0 for the chunked one
+	static int64 GetDenseCapacity(int32 InWidth, int32 InHeight, EESGridStorageLayout InLayout);
+
+	// Size within MaxSize, and only the chunked layout can be unbounded
+	static bool IsSupported(int32 InWidth, int32 InHeight, EESGridStorageLayout InLayout, EESGridBoundsMode InBoundsMode);
+
+	// Sizes above MaxSize are a caller error, dense layouts fall back to fixed bounds
+	void Initialize(int32 InWidth, int32 InHeight, EESGridStorageLayout InLayout,
+	                EESGridBoundsMode InBoundsMode = EESGridBoundsMode::Fixed);
+
+	// Set every cell back to None, releasing all chunks in the chunked layout
+	void Reset();
+
+	int32 GetWidth() const { return Width; }
+
+	int32 GetHeight() const { return Height; }
+
+	EESGridStorageLayout GetLayout() const { return Layout; }
+
+	EESGridBoundsMode GetBoundsMode() const { return BoundsMode; }
+
+	bool IsChunked() const { return Layout == EESGridStorageLayout::Chunked; }
+
+	// Valid positions, max exclusive
+	FIntRect GetValidBounds() const;
+
+	// Number of addressable storage indices, including padding and free chunk slots
+	int32 GetCapacity() const { return Cells.Num(); }
+
+	int32 GetNumChunks() const { return ChunkSlots.Num(); }
+
+	FORCEINLINE bool IsValid(int32 X, int32 Y) const
+	{
+		return BoundsMode == EESGridBoundsMode::Unbounded || (X >= 0 && X < Width && Y >= 0 && Y < Height);
+	}
+
+	// Slot of an allocated chunk, INDEX_NONE otherwise
+	FORCEINLINE int32 FindSlot(int32 ChunkX, int32 ChunkY) const
+	{
+		const int32* Slot = ChunkSlots.Find(FIntPoint(ChunkX, ChunkY));
+		return Slot ? *Slot : INDEX_NONE;
+	}
+
+	// Storage index of a valid position, INDEX_NONE when its chunk is not allocated
+	FORCEINLINE int32 ToIndex(int32 X, int32 Y) const
+	{
+		switch (Layout)
+		{
+		case EESGridStorageLayout::RowMajor:
+			return Y * Width + X;
+		case EESGridStorageLayout::Tiled:
+			{
+				const int32 Tile = (Y >> TileShift) * TilesX + (X >> TileShift);
+				return Tile * TileArea + ((Y & TileMask) << TileShift) + (X & TileMask);
+			}
+		default:
+			{
+				const int32 Slot = FindSlot(X >> ChunkShift, Y >> ChunkShift);
+				return Slot == INDEX_NONE ? INDEX_NONE : ChunkIndex(Slot, X, Y);
+			}
+		}
+	}
+
+	// Same as ToIndex, allocating the chunk when needed
+	int32 FindOrAddIndex(int32 X, int32 Y);
+
+	FIntPoint ToPoint(int32 Index) const;
+
+	FORCEINLINE EGroundType GetAt(int32 Index) const
+	{
+		return Cells.GetData()[Index];
+	}
+
+	// Occupied cells keep their chunk alive
+	FORCEINLINE void SetAt(int32 Index, EGroundType Type)
+	{
+		EGroundType& Cell = Cells.GetData()[Index];
+		if (IsChunked() && (Cell == GroundTypeNone) != (Type == GroundTypeNone))
+		{
+			Cell = Type;
+			if (Type == GroundTypeNone)
+			{
+				Release(Index);
+			}
+			else
+			{
+				Retain(Index);
+			}
+			return;
+		}
+		Cell = Type;
+	}
+
+	// Bounds-checked read, None outside the grid
+	FORCEINLINE EGroundType Get(int32 X, int32 Y) const
+	{
+		return IsValid(X, Y) ? GetUnchecked(X, Y) : GroundTypeNone;
+	}
+
+	FORCEINLINE EGroundType GetUnchecked(int32 X, int32 Y) const
+	{
+		checkSlow(IsValid(X, Y));
+		const int32 Index = ToIndex(X, Y);
+		return Index == INDEX_NONE ? GroundTypeNone : GetAt(Index);
+	}
+
+	// Bounds-checked write, returns false outside the grid
+	FORCEINLINE bool Set(int32 X, int32 Y, EGroundType Type)
+	{
+		if (!IsValid(X, Y))
+		{
+			return false;
+		}
+		SetUnchecked(X, Y, Type);
+		return true;
+	}
+
+	FORCEINLINE void SetUnchecked(int32 X, int32 Y, EGroundType Type)
+	{
+		checkSlow(IsValid(X, Y));
+		const int32 Index = Type == GroundTypeNone ? ToIndex(X, Y) : FindOrAddIndex(X, Y);
+		if (Index != INDEX_NONE)
+		{
+			SetAt(Index, Type);
+		}
+	}
+
+	// Copy the ChunkArea cells of one 64x64 block row by row, None where the grid has no cell
+	void ReadChunk(int32 ChunkX, int32 ChunkY, EGroundType* OutCells) const;
+
+	/**
+	 * Keep the chunk of a cell alive for data stored outside the storage.
+	 * No-op for dense layouts. The chunk is released when its last reference goes.
+	 */
+	void Retain(int32 Index);
+
+	void Release(int32 Index);
+
+	/**
+	 * Visit every cell in memory order.
+	 * Func is called as Func(X, Y, Type).
+	 */
+	template <typename FuncType>
+	void ForEachCell(FuncType&& Func) const
+	{
+		const EGroundType* Data = Cells.GetData();
+		if (Layout == EESGridStorageLayout::RowMajor)
+		{
+			for (int32 Y = 0; Y < Height; ++Y)
+			{
+				for (int32 X = 0; X < Width; ++X)
+				{
+					Func(X, Y, *Data++);
+				}
+			}
+			return;
+		}
+
+		if (Layout == EESGridStorageLayout::Chunked)
+		{
+			for (const auto& Pair : ChunkSlots)
+			{
+				const EGroundType* Chunk = Data + Pair.Value * ChunkArea;
+				const FIntPoint Base = Pair.Key * ChunkSize;
+				for (int32 Local = 0; Local < ChunkArea; ++Local)
+				{
+					Func(Base.X + (Local & ChunkMask), Base.Y + (Local >> ChunkShift), Chunk[Local]);
+				}
+			}
+			return;
+		}
+
+		for (int32 TileY = 0; TileY < TilesY; ++TileY)
+		{
+			for (int32 TileX = 0; TileX < TilesX; ++TileX)
+			{
+				const int32 BaseX = TileX << TileShift;
+				const int32 BaseY = TileY << TileShift;
+				for (int32 LocalY = 0; LocalY < TileSize; ++LocalY)
+				{
+					for (int32 LocalX = 0; LocalX < TileSize; ++LocalX, ++Data)
+					{
+						// Partial tiles on the right and bottom edges are padded
+						if (BaseX + LocalX < Width && BaseY + LocalY < Height)
+						{
+							Func(BaseX + LocalX, BaseY + LocalY, *Data);
+						}
+					}
+				}
+			}
+		}
+	}
+
+private:
+	FORCEINLINE static int32 ChunkIndex(int32 Slot, int32 X, int32 Y)
+	{
+		return Slot * ChunkArea + ((Y & ChunkMask) << ChunkShift) + (X & ChunkMask);
+	}
+
+	TArray<EGroundType> Cells;
+
+	int32 Width = 0;
+
+	int32 Height = 0;
+
+	int32 TilesX = 0;
+
+	int32 TilesY = 0;
+
+	EESGridStorageLayout Layout = EESGridStorageLayout::RowMajor;
+
+	EESGridBoundsMode BoundsMode = EESGridBoundsMode::Fixed;
+
+	// Chunked layout only
+	TMap<FIntPoint, int32> ChunkSlots;
+
+	TArray<FIntPoint> SlotChunks;
+
+	TArray<int32> SlotRefs;
+
+	TArray<int32> FreeSlots;
+};
@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridSubscriptions.cpp#
+ * Author: Yuyang Qiu
+ * Function:Grid change listeners dispatched through a bucket index.
+ */
+
+#include "Core/Grid/ESGridSubscriptions.h"
+
+#include "Core/Grid/ESGridCore.h"
+
+int32 FESGridSubscriptions::Add(const FIntRect& Region, uint32 TypeMask, FGridCellsChangedDelegate Delegate)
+{
+	TUniquePtr<FSubscription> Subscription = MakeUnique<FSubscription>();
+	Subscription->Region = Region;
+	Subscription->TypeMask = TypeMask;
+	Subscription->Delegate = MoveTemp(Delegate);
+	Subscription->bAnyCell = Region.Width() <= 0 || Region.Height() <= 0;
+
+	const FIntRect BucketRect = Subscription->bAnyCell ? FIntRect() : GetBucketRect(Region);
+	Subscription->bGlobal = Subscription->bAnyCell
+		|| int64(BucketRect.Width()) * BucketRect.Height() > MaxBucketsPerSubscription;
+	Subscription->Stamp = DispatchStamp;
+	Subscription->Handle = NextHandle++;
+
+	const bool bGlobal = Subscription->bGlobal;
+	const int32 Handle = Subscription->Handle;
+	const int32 Index = Subscriptions.Add(MoveTemp(Subscription));
+	HandleSlots.Add(Handle, Index);
+	if (bGlobal)
+	{
+		GlobalSubscriptions.Add(Index);
+		return Handle;
+	}
+
+	for (int32 Y = BucketRect.Min.Y; Y < BucketRect.Max.Y; ++Y)
+	{
+		for (int32 X = BucketRect.Min.X; X < BucketRect.Max.X; ++X)
+		{
+			Buckets.FindOrAdd(FIntPoint(X, Y)).Add(Index);
+		}
+	}
+	return Handle;
+}
+
+void FESGridSubscriptions::Remove(int32 Handle)
+{
+	// Unknown or already removed handles are ignored, they never name a newer subscription
+	const int32* Index = HandleSlots.Find(Handle);
+	if (!Index || Subscriptions[*Index]->bRemoved)
+	{
+		return;
+	}
+
+	// The dispatch may still be walking the lists, unlink once it is done
+	if (bDispatching)
+	{
+		Subscriptions[*Index]->bRemoved = true;
+		PendingRemovals.Add(*Index);
+		return;
+	}
+	Unlink(*Index);
+}
+
+void FESGridSubscriptions::Dispatch(const FGridEditBatch& Batch)
+{
+	if (Subscriptions.Num() == 0)
+	{
+		return;
+	}
+
+	// Edits made by a listener are sent once the current one is done, so every listener sees them in order
+	if (bDispatching)
+	{
+		QueuedBatches.Add(Batch);
+		return;
+	}
+
+	bDispatching = true;
+	DispatchBatch(Batch);
+	for (int32 i = 0; i < QueuedBatches.Num(); ++i)
+	{
+		const FGridEditBatch Queued = MoveTemp(QueuedBatches[i]);
+		DispatchBatch(Queued);
+	}
+	QueuedBatches.Reset();
+	bDispatching = false;
+
+	for (const int32 Index : PendingRemovals)
+	{
+		Unlink(Index);
+	}
+	PendingRemovals.Reset();
+}
+
+void FESGridSubscriptions::DispatchBatch(const FGridEditBatch& Batch)
+{
+	++DispatchStamp;
+	Notified.Reset();
+	auto Collect = [this](int32 Index, const FGridCellChange& Change, FIntPoint Cell, uint32 TypeBits)
+	{
+		FSubscription& Subscription = *Subscriptions[Index];
+		if (Subscription.bRemoved || (Subscription.TypeMask & TypeBits) == 0
+			|| (!Subscription.bAnyCell && !Subscription.Region.Contains(Cell)))
+		{
+			return;
+		}
+		if (Subscription.Stamp != DispatchStamp)
+		{
+			Subscription.Stamp = DispatchStamp;
+			Subscription.Changes.Reset();
+			Notified.Add(Index);
+		}
+		Subscription.Changes.Add(Change);
+	};
+
+	for (const FGridCellChange& Change : Batch.Changes)
+	{
+		const FIntPoint Cell(Change.X, Change.Y);
+		const uint32 TypeBits = (1u << static_cast<uint32>(Change.OldType)) | (1u << static_cast<uint32>(Change.NewType));
+		if (const TArray<int32>* Bucket = Buckets.Find(FIntPoint(Cell.X >> BucketShift, Cell.Y >> BucketShift)))
+		{
+			for (const int32 Index : *Bucket)
+			{
+				Collect(Index, Change, Cell, TypeBits);
+			}
+		}
+		for (const int32 Index : GlobalSubscriptions)
+		{
+			Collect(Index, Change, Cell, TypeBits);
+		}
+	}
+
+	for (const int32 Index : Notified)
+	{
+		FSubscription& Subscription = *Subscriptions[Index];
+		if (!Subscription.bRemoved)
+		{
+			Subscription.Delegate.ExecuteIfBound(Subscription.Changes);
+		}
+	}
+}
+
+void FESGridSubscriptions::Unlink(int32 Index)
+{
+	const FSubscription& Subscription = *Subscriptions[Index];
+	if (Subscription.bGlobal)
+	{
+		GlobalSubscriptions.RemoveSingle(Index);
+	}
+	else
+	{
+		const FIntRect BucketRect = GetBucketRect(Subscription.Region);
+		for (int32 Y = BucketRect.Min.Y; Y < BucketRect.Max.Y; ++Y)
+		{
+			for (int32 X = BucketRect.Min.X; X < BucketRect.Max.X; ++X)
+			{
+				const FIntPoint Key(X, Y);
+				TArray<int32>& Bucket = Buckets.FindChecked(Key);
+				Bucket.RemoveSingleSwap(Index, false);
+				if (Bucket.Num() == 0)
+				{
+					Buckets.Remove(Key);
+				}
+			}
+		}
+	}
+	HandleSlots.Remove(Subscription.Handle);
+	Subscriptions.RemoveAt(Index);
+}
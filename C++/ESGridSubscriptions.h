@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Grid/ESGridCore.h"
+
+// Matching changes of one committed edit
+DECLARE_DELEGATE_OneParam(FGridCellsChangedDelegate, const TArray<FGridCellChange>&);
+
+/**
+ * Grid change listeners filtered by region and ground type.
+ * Subscriptions are indexed in 64x64 buckets, a change only visits the listeners of its bucket.
+ * Listeners may subscribe and unsubscribe from their callback, new ones start with the next edit.
+ */
+class EVEOFTHESTORM_API FESGridSubscriptions
+{
+public:
+	static constexpr int32 BucketShift = 6;
+
+	// Regions spanning more buckets are checked against every change instead
+	static constexpr int32 MaxBucketsPerSubscription = 64;
+
+	// Bit 1 << EGroundType for every type, None included
+	static constexpr uint32 AllTypesMask = (1u << GroundTypeCount) - 1;
+
+	/**
+	 * Region is max exclusive, an empty one matches every cell.
+	 * A change matches when its old or new type is in TypeMask. Returns the handle for Remove,
+	 * handles are never reused so a stale one cannot remove a newer subscription.
+	 */
+	int32 Add(const FIntRect& Region, uint32 TypeMask, FGridCellsChangedDelegate Delegate);
+
+	void Remove(int32 Handle);
+
+	// Call every listener with a matching change once, with all of its matching changes
+	void Dispatch(const FGridEditBatch& Batch);
+
+	int32 Num() const { return Subscriptions.Num(); }
+
+private:
+	struct FSubscription
+	{
+		int32 Handle = INDEX_NONE;
+
+		FIntRect Region;
+
+		uint32 TypeMask = AllTypesMask;
+
+		FGridCellsChangedDelegate Delegate;
+
+		// Listed with the global subscriptions instead of in buckets
+		bool bGlobal = false;
+
+		bool bAnyCell = false;
+
+		bool bRemoved = false;
+
+		// Dispatch that last collected changes for this subscription
+		uint32 Stamp = 0;
+
+		TArray<FGridCellChange> Changes;
+	};
+
+	static FORCEINLINE FIntRect GetBucketRect(const FIntRect& Region)
+	{
+		return FIntRect(Region.Min.X >> BucketShift, Region.Min.Y >> BucketShift,
+		                ((Region.Max.X - 1) >> BucketShift) + 1, ((Region.Max.Y - 1) >> BucketShift) + 1);
+	}
+
+	void DispatchBatch(const FGridEditBatch& Batch);
+
+	void Unlink(int32 Index);
+
+	// Entries never move, so a callback adding subscriptions cannot invalidate the one being called
+	TSparseArray<TUniquePtr<FSubscription>> Subscriptions;
+
+	// Handle returned by Add to its index in Subscriptions, the indices are reused but the handles are not
+	TMap<int32, int32> HandleSlots;
+
+	int32 NextHandle = 0;
+
+	// Indices into Subscriptions, like the global and notified lists
+	TMap<FIntPoint, TArray<int32>> Buckets;
+
+	TArray<int32> GlobalSubscriptions;
+
+	// Subscriptions with changes in the current dispatch
+	TArray<int32> Notified;
+
+	uint32 DispatchStamp = 0;
+
+	bool bDispatching = false;
+
+	TArray<int32> PendingRemovals;
+
+	// Edits committed by listeners during a dispatch
+	TArray<FGridEditBatch> QueuedBatches;
+};
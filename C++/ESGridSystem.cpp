@@ -8,9 +8,14 @@
 
 #include "Core/Grid/ESGridSystem.h"
 
+#include "Async/ParallelFor.h"
 #include "Core/Grid/ESGridHelper.h"
+#include "Core/Grid/ESGridStats.h"
 #include "Core/Grid/ESGridType.h"
 #include "Core/Types/GroundType.h"
+#include "HAL/FileManager.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
 
 FIntPoint FGridTile::GetSize()
 {
@@ -25,25 +30,36 @@ FIntPoint FGridTile::GetSize()
 
 UESGridSystem::UESGridSystem() : UObject()
 {
-	Grid = TArray<TArray<EGroundType>>();
+	// Every per-type table of the core is sized by these counts
+	CheckGridEnumCounts();
+
+	// The core has no engine dependency, threading and shape rotation are plugged in here
+	Core.SetParallelFor([](int32 Num, TFunctionRef<void(int32)> Body)
+	{
+		ParallelFor(Num, Body);
+	});
+	Core.SetShapeRotator([](const TArray<FIntPoint>& Shape, EGridDirection Direction)
+	{
+		return UESGridHelper::RotateShape(Shape, Direction);
+	});
 }
 
-void UESGridSystem::InitializeGrid(int32 Width, int32 Height)
+void UESGridSystem::InitializeGrid(int32 Width, int32 Height, EGridStorageLayout Layout, EGridBoundsMode Bounds)
 {
 	GridSizeX = Width;
 	GridSizeY = Height;
+	GridLayout = Layout;
+	GridBounds = Bounds;
 
 	Initialize();
 }
 
 void UESGridSystem::Initialize()
 {
-	Grid.Empty();
-	Grid.SetNum(GridSizeY);
-	for (int i = 0; i < GridSizeY; i++)
-	{
-		Grid[i].SetNum(GridSizeX);
-	}
+	Core.Initialize(GridSizeX, GridSizeY, ToCore(GridLayout), ToCore(GridBounds));
+	Journal.Initialize(MaxUndoSteps, MaxUndoCells);
+	Regions.Rebuild(&Core);
+	ResetDistanceFields();
 }
 
 void UESGridSystem::PlaceInitialTile(TArray<FGridTile> Tiles, EGridDirection Direction)
@@ -51,52 +67,62 @@ void UESGridSystem::PlaceInitialTile(TArray<FGridTile> Tiles, EGridDirection Dir
 	const int32 X = GridSizeX / 2;
 	const int32 Y = GridSizeY / 2;
 
+	FESGridEditScope Edit(this);
 	for (auto& Tile : Tiles)
 	{
-		const FIntPoint Size = Tile.GetSize();
-		// const int32 X = GridSizeX / 2 - Size.X / 2;
-		// const int32 Y = GridSizeY / 2 - Size.Y / 2;
-		SetTile(X, Y, Tile.Shape, Tile.Type, Direction);
+		const FGridShapeHandle Handle = ResolveShape(Tile.Shape);
+		if (!CheckShape(Handle))
+		{
+			continue;
+		}
+		const FGridShape& Shape = Core.GetShapeLibrary().Get(Handle.ToCore());
+		// const int32 X = GridSizeX / 2 - Shape.Size.X / 2;
+		// const int32 Y = GridSizeY / 2 - Shape.Size.Y / 2;
+		SetTile(X, Y, Shape.GetRotation(Direction), Tile.Type);
 		// PlaceTile(X, Y, Tile, Direction);
 	}
 }
 
-EGroundType UESGridSystem::GetTileType(int X, int Y) const
+void UESGridSystem::GenerateTerrain(const FGridTerrainSettings& Settings)
 {
-	if (ValidPosition(X, Y))
-		return Grid[X][Y];
+	// Reachable from Blueprint inside BeginEdit, the bulk rebuild cannot run into an open edit
+	if (!ensure(!IsEditing()))
+	{
+		return;
+	}
+
+	const FIntRect Area(0, 0, GridSizeX, GridSizeY);
+	TArray<EGroundType> Cells;
+	FESGridTerrainGenerator::Generate(Settings, Area, Cells);
+
+	// Built like a load: one bulk rebuild for listeners instead of an event per cell
+	Core.BuildFromCells(Area, Cells.GetData());
+	FinishLoad(true);
+}
 
-	return EGroundType::None;
+EGroundType UESGridSystem::GetTileType(int X, int Y) const
+{
+	return Core.Get(X, Y);
 }
 
-bool UESGridSystem::HasTile(int X, int Y, const FGridTile Tile, EGridDirection Direction) const
+bool UESGridSystem::HasTile(int X, int Y, const FGridTile& Tile, EGridDirection Direction) const
 {
-	TArray<FIntPoint> RotatedShape = UESGridHelper::RotateShape(Tile.Shape, Direction);
+	return HasShape(X, Y, ResolveShape(Tile.Shape), Direction);
+}
 
-	if (!IsTileNearGround(X, Y, RotatedShape))
+bool UESGridSystem::HasShape(int X, int Y, FGridShapeHandle Shape, EGridDirection Direction) const
+{
+	// Reported as blocked, an unknown shape must never look like a free spot
+	if (!CheckShape(Shape))
 	{
 		return true;
 	}
-
-	for (const auto p : RotatedShape)
-	{
-		if (ValidPosition(X + p.X, Y + p.Y) &&
-			Grid[X + p.X][Y + p.Y] != EGroundType::None)
-		{
-			return true;
-		}
-	}
-	return false;
+	return Core.HasShape(X, Y, Shape.ToCore(), Direction);
 }
 
 bool UESGridSystem::IsPointNearGround(int X, int Y) const
 {
-	if (!ValidPosition(X, Y)) return false;
-
-	if (Grid[X + 1][Y] != EGroundType::None || Grid[X - 1][Y] != EGroundType::None ||
-		Grid[X][Y + 1] != EGroundType::None || Grid[X][Y - 1] != EGroundType::None)
-		return true;
-	return false;
+	return Core.IsPointNearGround(X, Y);
 }
 
 bool UESGridSystem::IsTileNearGround(int X, int Y, const TArray<FIntPoint>& Shape) const
@@ -109,49 +135,56 @@ bool UESGridSystem::IsTileNearGround(int X, int Y, const TArray<FIntPoint>& Shap
 	return false;
 }
 
-bool UESGridSystem::CanPlaceTile(int X, int Y, const FGridTile Tile, EGridDirection Direction) const
+bool UESGridSystem::CanPlaceTile(int X, int Y, const FGridTile& Tile, EGridDirection Direction) const
 {
-	TArray<FIntPoint> RotatedShape = UESGridHelper::RotateShape(Tile.Shape, Direction);
-	if (!IsTileNearGround(X, Y, RotatedShape))
+	return CanPlaceShape(X, Y, ResolveShape(Tile.Shape), Direction);
+}
+
+bool UESGridSystem::CanPlaceShape(int X, int Y, FGridShapeHandle Shape, EGridDirection Direction) const
+{
+	if (!CheckShape(Shape))
 	{
 		return false;
 	}
+	return Core.CanPlaceShape(X, Y, Shape.ToCore(), Direction);
+}
 
-	for (const auto p : RotatedShape)
-	{
-		if (!ValidPosition(X + p.X, Y + p.Y))
-		{
-			return false;
-		}
-	}
-	return true;
+bool UESGridSystem::PlaceTile(int X, int Y, const FGridTile& Tile, EGridDirection Direction)
+{
+	return PlaceShape(X, Y, ResolveShape(Tile.Shape), Tile.Type, Direction);
 }
 
-bool UESGridSystem::PlaceTile(int X, int Y, FGridTile Tile, EGridDirection Direction)
+bool UESGridSystem::PlaceShape(int X, int Y, FGridShapeHandle Shape, EGroundType Type, EGridDirection Direction)
 {
-	if (!HasTile(X, Y, Tile, Direction))
+	if (!CheckShape(Shape))
 	{
-		SetTile(X, Y, Tile.Shape, Tile.Type, Direction);
-		return true;
+		return false;
 	}
-	return false;
+	FESGridEditScope Edit(this);
+	return Core.PlaceShape(X, Y, Shape.ToCore(), Type, Direction);
+}
+
+void UESGridSystem::RemoveTile(int X, int Y, const FGridTile& Tile, EGridDirection Direction)
+{
+	RemoveShape(X, Y, ResolveShape(Tile.Shape), Direction);
 }
 
-void UESGridSystem::RemoveTile(int X, int Y, FGridTile Tile, EGridDirection Direction)
+void UESGridSystem::RemoveShape(int X, int Y, FGridShapeHandle Shape, EGridDirection Direction)
 {
-	if (CanPlaceTile(X, Y, Tile, Direction))
+	if (!CheckShape(Shape))
 	{
-		SetTile(X, Y, Tile.Shape, EGroundType::None, Direction);
+		return;
 	}
+	FESGridEditScope Edit(this);
+	Core.RemoveShape(X, Y, Shape.ToCore(), Direction);
 }
 
 void UESGridSystem::RemoveOneTile(int X, int Y)
 {
 	if (ValidPosition(X, Y))
 	{
-		EGroundType OldType = Grid[X][Y];
-		Grid[X][Y] = EGroundType::None;
-		OnTileRemovedEvent.Broadcast(X, Y, OldType);
+		FESGridEditScope Edit(this);
+		Core.WriteCell(X, Y, EGroundType::None);
 	}
 }
 
@@ -159,81 +192,352 @@ void UESGridSystem::UpdateOneTile(int X, int Y, EGroundType Type)
 {
 	if (ValidPosition(X, Y))
 	{
-		EGroundType OldType = Grid[X][Y];
-		Grid[X][Y] = Type;
-		OnTileChangeEvent.Broadcast(X, Y, OldType, Type);
+		FESGridEditScope Edit(this);
+		Core.WriteCell(X, Y, Type);
 	}
 }
 
-void UESGridSystem::UpdateTile(int X, int Y, FGridTile Tile, EGridDirection Direction)
+void UESGridSystem::UpdateTile(int X, int Y, const FGridTile& Tile, EGridDirection Direction)
+{
+	UpdateShape(X, Y, ResolveShape(Tile.Shape), Tile.Type, Direction);
+}
+
+void UESGridSystem::UpdateShape(int X, int Y, FGridShapeHandle Shape, EGroundType Type, EGridDirection Direction)
 {
-	if (CanPlaceTile(X, Y, Tile, Direction))
+	if (!CheckShape(Shape))
 	{
-		SetTile(X, Y, Tile.Shape, Tile.Type, Direction);
+		return;
 	}
+	FESGridEditScope Edit(this);
+	Core.UpdateShape(X, Y, Shape.ToCore(), Type, Direction);
+}
+
+FGridShapeHandle UESGridSystem::RegisterShape(const FGridTile& Tile)
+{
+	return FGridShapeHandle(Core.RegisterShape(Tile.Shape));
 }
 
 TArray<FIntPoint> UESGridSystem::GetPoints(int Count)
 {
-	TArray<FIntPoint> Result;
-	for (int i = 0; i < GridSizeY; i++)
-	{
-		for (int j = 0; j < GridSizeX; ++j)
-		{
-			if (Grid[j][i] == EGroundType::None) continue;
+	return GetPointsOfType(EGroundType::None, Count);
+}
 
-			Result.Add(FIntPoint(j, i));
-		}
+TArray<FIntPoint> UESGridSystem::GetPointsOfType(EGroundType Type, int32 Count) const
+{
+	return Core.GetPointsOfType(Type, Count);
+}
+
+int32 UESGridSystem::GetOccupiedCount(EGroundType Type) const
+{
+	return Core.GetOccupiedCount(Type);
+}
+
+bool UESGridSystem::GetRandomPoint(const FRandomStream& Stream, FIntPoint& OutPoint, EGroundType Type) const
+{
+	return Core.GetRandomPoint(Stream, OutPoint, Type);
+}
+
+int32 UESGridSystem::CountTilesInRegion(EGroundType Type, FIntPoint RegionMin, FIntPoint RegionMax) const
+{
+	return Core.CountInRect(Type, FIntRect(RegionMin, RegionMax + FIntPoint(1, 1)));
+}
+
+bool UESGridSystem::IsRegionFilled(FIntPoint RegionMin, FIntPoint RegionMax, EGroundType Type) const
+{
+	return Core.GetAreaCounts().IsFilled(Type, FIntRect(RegionMin, RegionMax + FIntPoint(1, 1)));
+}
+
+TArray<int32> UESGridSystem::GetDensityMap(EGroundType Type, FIntPoint RegionMin, FIntPoint RegionMax, int32 CellSize) const
+{
+	TArray<int32> Counts;
+	Core.GetAreaCounts().GetDensityMap(Type, FIntRect(RegionMin, RegionMax + FIntPoint(1, 1)), CellSize, Counts);
+	return Counts;
+}
+
+TArray<FGridPlacement> UESGridSystem::FindValidPlacements(const FGridTile& Tile, bool bRanked, int32 MaxResults) const
+{
+	return FindShapePlacements(ResolveShape(Tile.Shape), nullptr, bRanked, MaxResults);
+}
+
+TArray<FGridPlacement> UESGridSystem::FindValidPlacementsInRegion(const FGridTile& Tile, FIntPoint RegionMin,
+	FIntPoint RegionMax, bool bRanked, int32 MaxResults) const
+{
+	const FIntRect Region(RegionMin, RegionMax + FIntPoint(1, 1));
+	return FindShapePlacements(ResolveShape(Tile.Shape), &Region, bRanked, MaxResults);
+}
+
+TArray<FGridPlacement> UESGridSystem::FindShapePlacements(FGridShapeHandle Shape, const FIntRect* Region, bool bRanked,
+	int32 MaxResults) const
+{
+	if (!CheckShape(Shape))
+	{
+		return TArray<FGridPlacement>();
 	}
-	return Result;
+	return ToBlueprint(Core.FindShapePlacements(Shape.ToCore(), Region, bRanked, MaxResults));
+}
+
+bool UESGridSystem::IsFrontierCell(int X, int Y) const
+{
+	return Core.IsFrontierCell(X, Y);
+}
+
+TArray<FIntPoint> UESGridSystem::GetFrontierPoints() const
+{
+	return Core.GetFrontierPoints();
+}
+
+int32 UESGridSystem::GetNeighbourCount(int X, int Y) const
+{
+	return Core.GetNeighbourCount(X, Y);
+}
+
+bool UESGridSystem::CheckShape(FGridShapeHandle Shape) const
+{
+	return ensureMsgf(Core.GetShapeLibrary().IsValid(Shape.ToCore()), TEXT("Shape handle %d was not registered with this grid"),
+	                  Shape.Index);
 }
 
 bool UESGridSystem::ValidPosition(int X, int Y)  const
 {
-	return !(X < 0 || X >= GridSizeX || Y < 0 || Y >= GridSizeY);
+	return Core.IsValid(X, Y);
 }
 
 bool UESGridSystem::IsGroundValid(int X, int Y, const TArray<FIntPoint>& Shape, EGroundType InGroundType)
 {
-	for (const auto p : Shape)
+	return Core.IsGroundValid(X, Y, Shape, InGroundType);
+}
+
+void UESGridSystem::SetTile(int X, int Y, const FGridShapeRotation& Shape, const EGroundType Type)
+{
+	FESGridEditScope Edit(this);
+	Core.SetShape(X, Y, Shape, Type);
+}
+
+int32 UESGridSystem::RegisterDistanceField(const TArray<EGroundType>& Sources, int32 MaxDistance)
+{
+	uint32 SourceMask = 0;
+	for (const EGroundType Type : Sources)
 	{
-		if (InGroundType == EGroundType::None)
+		SourceMask |= 1u << static_cast<uint32>(Type);
+	}
+
+	TUniquePtr<FESGridDistanceField> Field = MakeUnique<FESGridDistanceField>();
+	Field->Initialize(&Core, GetFieldBounds(), SourceMask, MaxDistance);
+	const int32 Id = NextDistanceFieldId++;
+	DistanceFieldSlots.Add(Id, DistanceFields.Add(MoveTemp(Field)));
+	return Id;
+}
+
+void UESGridSystem::UnregisterDistanceField(int32 Field)
+{
+	int32 Index;
+	if (DistanceFieldSlots.RemoveAndCopyValue(Field, Index))
+	{
+		DistanceFields.RemoveAt(Index);
+	}
+}
+
+int32 UESGridSystem::GetFieldDistance(int32 Field, int X, int Y) const
+{
+	const FESGridDistanceField* DistanceField = GetDistanceField(Field);
+	return DistanceField ? DistanceField->GetDistance(X, Y) : 0;
+}
+
+float UESGridSystem::GetFieldInfluence(int32 Field, int X, int Y) const
+{
+	const FESGridDistanceField* DistanceField = GetDistanceField(Field);
+	return DistanceField ? DistanceField->GetInfluence(X, Y) : 0.f;
+}
+
+const FESGridDistanceField* UESGridSystem::GetDistanceField(int32 Field) const
+{
+	const int32* Index = DistanceFieldSlots.Find(Field);
+	return Index ? DistanceFields[*Index].Get() : nullptr;
+}
+
+FIntRect UESGridSystem::GetFieldBounds() const
+{
+	return FIntRect(0, 0, GridSizeX, GridSizeY);
+}
+
+void UESGridSystem::ResetDistanceFields()
+{
+	// Fields are kept, only their area follows the new grid
+	for (TUniquePtr<FESGridDistanceField>& Field : DistanceFields)
+	{
+		Field->Initialize(&Core, GetFieldBounds(), Field->GetSourceMask(), Field->GetMaxDistance());
+	}
+}
+
+bool UESGridSystem::SaveToFile(const FString& Path) const
+{
+	const TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Path));
+	if (!Writer)
+	{
+		return false;
+	}
+	Core.Save(*Writer);
+	return Writer->Close();
+}
+
+bool UESGridSystem::LoadFromFile(const FString& Path)
+{
+	// Reachable from Blueprint inside BeginEdit, a load cannot replace the grid under an open edit
+	if (!ensure(!IsEditing()))
+	{
+		return false;
+	}
+
+	const TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Path));
+	if (!Reader)
+	{
+		return false;
+	}
+	return FinishLoad(Core.Load(*Reader));
+}
+
+void UESGridSystem::SaveToBytes(TArray<uint8>& OutData) const
+{
+	OutData.Reset();
+	FMemoryWriter Writer(OutData);
+	Core.Save(Writer);
+}
+
+bool UESGridSystem::LoadFromBytes(const TArray<uint8>& Data)
+{
+	if (!ensure(!IsEditing()))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+	return FinishLoad(Core.Load(Reader));
+}
+
+bool UESGridSystem::FinishLoad(bool bLoaded)
+{
+	const FESGridStorage& Storage = Core.GetStorage();
+	GridSizeX = Storage.GetWidth();
+	GridSizeY = Storage.GetHeight();
+	GridLayout = ToBlueprint(Storage.GetLayout());
+	GridBounds = ToBlueprint(Storage.GetBoundsMode());
+
+	// The history describes the grid that was replaced
+	Journal.Reset();
+	Regions.Rebuild(&Core);
+	ResetDistanceFields();
+
+	// A failed load may already have cleared the grid, listeners rebuild either way
+	OnGridLoadedEvent.Broadcast();
+	return bLoaded;
+}
+
+void UESGridSystem::BeginEdit()
+{
+	Core.BeginEdit();
+}
+
+void UESGridSystem::CommitEdit()
+{
+	FGridEditBatch Batch;
+	if (Core.CommitEdit(Batch))
+	{
+		if (!bReplayingJournal)
+		{
+			Journal.Record(Batch);
+		}
+
+		TArray<FGridRegionEvent> RegionEvents;
+		Regions.Apply(Batch, RegionEvents);
+		for (TUniquePtr<FESGridDistanceField>& Field : DistanceFields)
 		{
-			if (Grid[X + p.X][Y + p.Y] == EGroundType::None)
-			{
-				return false;
-			}
+			Field->Update(Batch);
 		}
-		else if (Grid[X + p.X][Y + p.Y] != InGroundType)
+		BroadcastBatch(Batch);
+		if (RegionEvents.Num() > 0)
 		{
-			return false;
+			OnRegionsChangedEvent.Broadcast(RegionEvents);
 		}
 	}
+}
+
+bool UESGridSystem::Undo()
+{
+	// Reachable from Blueprint inside BeginEdit, history cannot be replayed into an open edit
+	if (!ensure(!IsEditing()))
+	{
+		return false;
+	}
+	TArray<FGridCellChange> Changes;
+	if (!Journal.Undo(Changes))
+	{
+		return false;
+	}
+
+	TGuardValue<bool> Replaying(bReplayingJournal, true);
+	FESGridEditScope Edit(this);
+	for (const FGridCellChange& Change : Changes)
+	{
+		Core.WriteCell(Change.X, Change.Y, Change.OldType);
+	}
 	return true;
 }
 
-void UESGridSystem::SetTile(int X, int Y, const TArray<FIntPoint> Tile, const EGroundType Type,
-	EGridDirection Direction)
+bool UESGridSystem::Redo()
 {
-	TArray<FIntPoint> RotatedShape = UESGridHelper::RotateShape(Tile, Direction);
-	for (const auto p : RotatedShape)
+	// Reachable from Blueprint inside BeginEdit, history cannot be replayed into an open edit
+	if (!ensure(!IsEditing()))
 	{
-		EGroundType OldGround = Grid[X + p.X][Y + p.Y];
-		Grid[X + p.X][Y + p.Y] = Type;
-		// If not remove
-		if (OldGround != EGroundType::None && Type != EGroundType::None)
+		return false;
+	}
+	TArray<FGridCellChange> Changes;
+	if (!Journal.Redo(Changes))
+	{
+		return false;
+	}
+
+	TGuardValue<bool> Replaying(bReplayingJournal, true);
+	FESGridEditScope Edit(this);
+	for (const FGridCellChange& Change : Changes)
+	{
+		Core.WriteCell(Change.X, Change.Y, Change.NewType);
+	}
+	return true;
+}
+
+void UESGridSystem::ClearUndoHistory()
+{
+	Journal.Reset();
+}
+
+void UESGridSystem::BroadcastBatch(const FGridEditBatch& Batch)
+{
+	ES_GRID_SCOPE(BroadcastBatch);
+
+	OnTilesChangedEvent.Broadcast(Batch);
+	Subscriptions.Dispatch(Batch);
+
+	if (!OnTilePlacedEvent.IsBound() && !OnTileRemovedEvent.IsBound() && !OnTileChangeEvent.IsBound())
+	{
+		return;
+	}
+
+	for (const FGridCellChange& Change : Batch.Changes)
+	{
+		// If placing
+		if (Change.OldType == EGroundType::None)
 		{
-			OnTileChangeEvent.Broadcast(X + p.X, Y + p.Y, OldGround, Type);
+			OnTilePlacedEvent.Broadcast(Change.X, Change.Y, Change.NewType);
 		}
 		// if removing
-		else if (Type == EGroundType::None)
+		else if (Change.NewType == EGroundType::None)
 		{
-			OnTileRemovedEvent.Broadcast(X + p.X, Y + p.Y, OldGround);
+			OnTileRemovedEvent.Broadcast(Change.X, Change.Y, Change.OldType);
 		}
-		// If placing
+		// If not remove
 		else
 		{
-			OnTilePlacedEvent.Broadcast(X + p.X, Y + p.Y, Type);
+			OnTileChangeEvent.Broadcast(Change.X, Change.Y, Change.OldType, Change.NewType);
 		}
 	}
 }
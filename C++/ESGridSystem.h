@@ -6,6 +6,13 @@
 #include "UObject/Object.h"
 #include "Core/Types/GroundType.h"
 #include "Core/Grid/ESGridType.h"
+#include "Core/Grid/ESGridCore.h"
+#include "Core/Grid/ESGridBlueprintTypes.h"
+#include "Core/Grid/ESGridJournal.h"
+#include "Core/Grid/ESGridRegions.h"
+#include "Core/Grid/ESGridDistanceField.h"
+#include "Core/Grid/ESGridSubscriptions.h"
+#include "Core/Grid/ESGridTerrainGenerator.h"
 #include "ESGridSystem.generated.h"
 
 USTRUCT(BlueprintType)
@@ -39,7 +46,22 @@ public:
 	UPROPERTY(BlueprintReadOnly, Transient)
 		int32 GridSizeY = 256;
 
-	void InitializeGrid(int32 Width, int32 Height);
+	UPROPERTY(BlueprintReadOnly, Transient)
+		EGridStorageLayout GridLayout = EGridStorageLayout::RowMajor;
+
+	// Unbounded only applies to the chunked layout, GridSizeX and GridSizeY then only place the initial tiles
+	UPROPERTY(BlueprintReadOnly, Transient)
+		EGridBoundsMode GridBounds = EGridBoundsMode::Fixed;
+
+	// Undo history limits, applied by Initialize
+	UPROPERTY(BlueprintReadWrite)
+		int32 MaxUndoSteps = 256;
+
+	UPROPERTY(BlueprintReadWrite)
+		int32 MaxUndoCells = 1 << 18;
+
+	void InitializeGrid(int32 Width, int32 Height, EGridStorageLayout Layout = EGridStorageLayout::RowMajor,
+		EGridBoundsMode Bounds = EGridBoundsMode::Fixed);
 
 	UFUNCTION(BlueprintCallable)
 		void Initialize();
@@ -47,11 +69,15 @@ public:
 	UFUNCTION(BlueprintCallable)
 		void PlaceInitialTile(TArray<FGridTile> Tiles, EGridDirection Direction);
 
+	// Replace the grid with seeded terrain over GridSizeX x GridSizeY, listeners get it as one OnGridLoaded. Ignored inside an open edit
+	UFUNCTION(BlueprintCallable)
+		void GenerateTerrain(const FGridTerrainSettings& Settings);
+
 	UFUNCTION(BlueprintCallable)
 		EGroundType GetTileType(int X, int Y) const;
 
 	UFUNCTION(BlueprintCallable)
-		bool HasTile(int X, int Y, const FGridTile Tile, EGridDirection Direction) const;
+		bool HasTile(int X, int Y, const FGridTile& Tile, EGridDirection Direction) const;
 
 	UFUNCTION(BlueprintCallable)
 		bool IsPointNearGround(int X, int Y) const;
@@ -60,13 +86,13 @@ public:
 		bool IsTileNearGround(int X, int Y, const TArray<FIntPoint>& Shape) const;
 
 	UFUNCTION(BlueprintCallable)
-		bool CanPlaceTile(int X, int Y, const FGridTile Tile, EGridDirection Direction) const;
+		bool CanPlaceTile(int X, int Y, const FGridTile& Tile, EGridDirection Direction) const;
 
 	UFUNCTION(BlueprintCallable)
-		bool PlaceTile(int X, int Y, FGridTile Tile, EGridDirection Direction);
+		bool PlaceTile(int X, int Y, const FGridTile& Tile, EGridDirection Direction);
 
 	UFUNCTION(BlueprintCallable)
-		void RemoveTile(int X, int Y, FGridTile Tile, EGridDirection Direction);
+		void RemoveTile(int X, int Y, const FGridTile& Tile, EGridDirection Direction);
 
 	UFUNCTION(BlueprintCallable)
 		void RemoveOneTile(int X, int Y);
@@ -75,11 +101,91 @@ public:
 		void UpdateOneTile(int X, int Y, EGroundType Type);
 
 	UFUNCTION(BlueprintCallable)
-		void UpdateTile(int X, int Y, FGridTile Tile, EGridDirection Direction);
+		void UpdateTile(int X, int Y, const FGridTile& Tile, EGridDirection Direction);
+
+	// SHAPE HANDLES
+
+	UFUNCTION(BlueprintCallable)
+		FGridShapeHandle RegisterShape(const FGridTile& Tile);
+
+	// True when the footprint is blocked, also for a handle this grid does not know
+	UFUNCTION(BlueprintCallable)
+		bool HasShape(int X, int Y, FGridShapeHandle Shape, EGridDirection Direction) const;
+
+	UFUNCTION(BlueprintCallable)
+		bool CanPlaceShape(int X, int Y, FGridShapeHandle Shape, EGridDirection Direction) const;
+
+	UFUNCTION(BlueprintCallable)
+		bool PlaceShape(int X, int Y, FGridShapeHandle Shape, EGroundType Type, EGridDirection Direction);
+
+	UFUNCTION(BlueprintCallable)
+		void RemoveShape(int X, int Y, FGridShapeHandle Shape, EGridDirection Direction);
+
+	UFUNCTION(BlueprintCallable)
+		void UpdateShape(int X, int Y, FGridShapeHandle Shape, EGroundType Type, EGridDirection Direction);
+
+	const FESGridShapeLibrary& GetShapeLibrary() const { return Core.GetShapeLibrary(); }
+
+	// PLACEMENT QUERIES
+
+	// Every position and direction where the tile can be placed, split across worker threads
+	UFUNCTION(BlueprintCallable)
+		TArray<FGridPlacement> FindValidPlacements(const FGridTile& Tile, bool bRanked = false, int32 MaxResults = 0) const;
+
+	// Same as FindValidPlacements with anchors limited to [RegionMin, RegionMax]
+	UFUNCTION(BlueprintCallable)
+		TArray<FGridPlacement> FindValidPlacementsInRegion(const FGridTile& Tile, FIntPoint RegionMin, FIntPoint RegionMax,
+			bool bRanked = false, int32 MaxResults = 0) const;
+
+	TArray<FGridPlacement> FindShapePlacements(FGridShapeHandle Shape, const FIntRect* Region = nullptr,
+		bool bRanked = false, int32 MaxResults = 0) const;
+
+	// Bring the set up to date, only rechecking anchors around the last edit when possible
+	void UpdatePlacementSet(FESGridPlacementSet& Set) const
+	{
+		if (CheckShape(FGridShapeHandle(Set.Shape)))
+		{
+			Core.UpdatePlacementSet(Set);
+		}
+	}
+
+	// Incremented by every edit
+	int32 GetEditVersion() const { return Core.GetEditVersion(); }
 
 	UFUNCTION(BlueprintCallable)
 		TArray<FIntPoint> GetPoints(int Count);
 
+	// OCCUPIED CELLS
+
+	// Up to Count cells of one type, or of any type for None. Count <= 0 returns all of them
+	UFUNCTION(BlueprintCallable)
+		TArray<FIntPoint> GetPointsOfType(EGroundType Type, int32 Count = 0) const;
+
+	// Number of cells of one type, or of any type for None
+	UFUNCTION(BlueprintCallable)
+		int32 GetOccupiedCount(EGroundType Type = EGroundType::None) const;
+
+	// Uniformly picked cell of one type, or of any type for None. False when there is none
+	UFUNCTION(BlueprintCallable)
+		bool GetRandomPoint(const FRandomStream& Stream, FIntPoint& OutPoint, EGroundType Type = EGroundType::None) const;
+
+	// Cells of one non-empty type, as storage indices
+	const TArray<int32>& GetOccupiedCells(EGroundType Type) const { return Core.GetOccupiedCells(Type); }
+
+	// AREA QUERIES
+
+	// Cells of one type in [RegionMin, RegionMax], or of any type for None
+	UFUNCTION(BlueprintCallable)
+		int32 CountTilesInRegion(EGroundType Type, FIntPoint RegionMin, FIntPoint RegionMax) const;
+
+	// Every cell in [RegionMin, RegionMax] is ground, of Type unless it is None
+	UFUNCTION(BlueprintCallable)
+		bool IsRegionFilled(FIntPoint RegionMin, FIntPoint RegionMax, EGroundType Type = EGroundType::None) const;
+
+	// Cell counts of CellSize squares covering [RegionMin, RegionMax], row by row
+	UFUNCTION(BlueprintCallable)
+		TArray<int32> GetDensityMap(EGroundType Type, FIntPoint RegionMin, FIntPoint RegionMax, int32 CellSize = 8) const;
+
 	DECLARE_EVENT_ThreeParams(UESGridSystem, FOnTilePlacedEvent, int, int, EGroundType)
 		FOnTilePlacedEvent& OnTilePlaced() { return OnTilePlacedEvent; }
 
@@ -89,16 +195,172 @@ public:
 	DECLARE_EVENT_FourParams(UESGridSystem, FOnTileChangedEvent, int, int, EGroundType, EGroundType)
 		FOnTileChangedEvent& OnTileChanged() { return OnTileChangeEvent; }
 
+	// One broadcast per committed edit, for listeners that prefer batches over the per-cell events
+	DECLARE_EVENT_OneParam(UESGridSystem, FOnTilesChangedEvent, const FGridEditBatch&)
+		FOnTilesChangedEvent& OnTilesChanged() { return OnTilesChangedEvent; }
+
+	// The whole grid was replaced by a load, no per-cell or batch event is sent for it
+	DECLARE_EVENT(UESGridSystem, FOnGridLoadedEvent)
+		FOnGridLoadedEvent& OnGridLoaded() { return OnGridLoadedEvent; }
+
+	// FILTERED LISTENERS
+
+	/**
+	 * Call Delegate once per committed edit with its changes inside Region (max exclusive), an empty Region matches every cell.
+	 * TypeMask has bit 1 << EGroundType set for every type of interest, a change matches on its old or new type.
+	 */
+	int32 SubscribeToRegion(const FIntRect& Region, FGridCellsChangedDelegate Delegate,
+		uint32 TypeMask = FESGridSubscriptions::AllTypesMask) { return Subscriptions.Add(Region, TypeMask, MoveTemp(Delegate)); }
+
+	void UnsubscribeFromRegion(int32 Handle) { Subscriptions.Remove(Handle); }
+
+	// REGIONS
+
+	// Connected region of a cell, of any ground or of its own type only. INDEX_NONE for empty cells
+	UFUNCTION(BlueprintCallable)
+		int32 GetRegion(int X, int Y, bool bByType = false) const { return Regions.GetRegion(X, Y, bByType); }
+
+	UFUNCTION(BlueprintCallable)
+		int32 GetRegionSize(int32 Region) const { return Regions.GetRegionSize(Region); }
+
+	UFUNCTION(BlueprintCallable)
+		int32 GetNumRegions(bool bByType = false) const { return Regions.GetNumRegions(bByType); }
+
+	const FESGridRegions& GetRegions() const { return Regions; }
+
+	// Regions merged or split by a committed edit, sent after OnTilesChanged
+	DECLARE_EVENT_OneParam(UESGridSystem, FOnRegionsChangedEvent, const TArray<FGridRegionEvent>&)
+		FOnRegionsChangedEvent& OnRegionsChanged() { return OnRegionsChangedEvent; }
+
+	// DISTANCE FIELDS
+
+	/**
+	 * Distance from every cell to the nearest cell of one of the Sources types, capped at MaxDistance.
+	 * Returns the field id, ids are never reused so a stale one cannot reach a newer field.
+	 * None as a source gives the distance to the island edge. Unbounded grids cover the initial GridSizeX x GridSizeY area.
+	 */
+	UFUNCTION(BlueprintCallable)
+		int32 RegisterDistanceField(const TArray<EGroundType>& Sources, int32 MaxDistance = 32);
+
+	UFUNCTION(BlueprintCallable)
+		void UnregisterDistanceField(int32 Field);
+
+	UFUNCTION(BlueprintCallable)
+		int32 GetFieldDistance(int32 Field, int X, int Y) const;
+
+	// 1 on a source, falling to 0 at the field's MaxDistance
+	UFUNCTION(BlueprintCallable)
+		float GetFieldInfluence(int32 Field, int X, int Y) const;
+
+	// Null for unknown ids, read GetDistances for bulk sampling
+	const FESGridDistanceField* GetDistanceField(int32 Field) const;
+
+	// PERSISTENCE
+
+	UFUNCTION(BlueprintCallable)
+		bool SaveToFile(const FString& Path) const;
+
+	// Streams the file block by block, the grid size and layout come from the file. Returns false inside an open edit
+	UFUNCTION(BlueprintCallable)
+		bool LoadFromFile(const FString& Path);
+
+	// Same format in memory, for save game objects
+	void SaveToBytes(TArray<uint8>& OutData) const;
+
+	bool LoadFromBytes(const TArray<uint8>& Data);
+
+	// EDIT TRANSACTIONS
+
+	/**
+	 * Start collecting changes. Transactions nest, events are sent when the outermost one commits.
+	 * Every edit function opens its own transaction, so a lone PlaceTile is already one batch.
+	 */
+	UFUNCTION(BlueprintCallable)
+		void BeginEdit();
+
+	UFUNCTION(BlueprintCallable)
+		void CommitEdit();
+
+	bool IsEditing() const { return Core.IsEditing(); }
+
+	// UNDO
+
+	// Revert the last committed edit, listeners get it as one batch. Returns false inside an open edit
+	UFUNCTION(BlueprintCallable)
+		bool Undo();
+
+	UFUNCTION(BlueprintCallable)
+		bool Redo();
+
+	UFUNCTION(BlueprintCallable)
+		bool CanUndo() const { return Journal.CanUndo(); }
+
+	UFUNCTION(BlueprintCallable)
+		bool CanRedo() const { return Journal.CanRedo(); }
+
+	UFUNCTION(BlueprintCallable)
+		void ClearUndoHistory();
+
 	UFUNCTION(BlueprintCallable)
 		bool ValidPosition(int X, int Y) const;
 
 	UFUNCTION(BlueprintCallable, Category = "ES|Building")
 		bool IsGroundValid(int X, int Y, const TArray<FIntPoint>& Shape, EGroundType InGroundType = EGroundType::None);
 
+	// Read-only copy for worker threads, see FESGridCore::TakeSnapshot
+	FESGridSnapshotRef TakeSnapshot() { return Core.TakeSnapshot(); }
+
+	// Engine independent state and logic, edits go through this object so listeners hear about them
+	const FESGridCore& GetCore() const { return Core; }
+
+	const FESGridStorage& GetStorage() const { return Core.GetStorage(); }
+
+	// Bit set for every non-empty cell
+	const FESGridBitboard& GetOccupiedBits() const { return Core.GetOccupiedBits(); }
+
+	// Bit set for every cell with at least one non-empty 4-neighbour
+	const FESGridBitboard& GetAdjacentBits() const { return Core.GetAdjacentBits(); }
+
+	// FRONTIER
+
+	// Empty cells with at least one non-empty 4-neighbour, as storage indices
+	const FESGridCellSet& GetFrontier() const { return Core.GetFrontier(); }
+
+	UFUNCTION(BlueprintCallable)
+		bool IsFrontierCell(int X, int Y) const;
+
+	UFUNCTION(BlueprintCallable)
+		TArray<FIntPoint> GetFrontierPoints() const;
+
+	// Non-empty 4-neighbours of a cell, 0 outside the grid
+	UFUNCTION(BlueprintCallable)
+		int32 GetNeighbourCount(int X, int Y) const;
+
 protected:
-	void SetTile(int X, int Y, const TArray<FIntPoint> Tile, const EGroundType Type, EGridDirection Direction);
+	void SetTile(int X, int Y, const FGridShapeRotation& Shape, const EGroundType Type);
+
+	void BroadcastBatch(const FGridEditBatch& Batch);
+
+	// Find the interned shape, registering it on first use
+	FGridShapeHandle ResolveShape(const TArray<FIntPoint>& Shape) const { return FGridShapeHandle(Core.ResolveShape(Shape)); }
 
-	TArray<TArray<EGroundType>> Grid;
+	FESGridCore Core;
+
+	FESGridJournal Journal;
+
+	FESGridRegions Regions;
+
+	TSparseArray<TUniquePtr<FESGridDistanceField>> DistanceFields;
+
+	// Field id returned by RegisterDistanceField to its index in DistanceFields, the indices are reused but the ids are not
+	TMap<int32, int32> DistanceFieldSlots;
+
+	int32 NextDistanceFieldId = 0;
+
+	FESGridSubscriptions Subscriptions;
+
+	// Set while undo or redo writes cells, so the replay is not journaled again
+	bool bReplayingJournal = false;
 
 private:
 	FOnTilePlacedEvent OnTilePlacedEvent;
@@ -106,4 +368,45 @@ private:
 	FOnTileRemovedEvent OnTileRemovedEvent;
 
 	FOnTileChangedEvent OnTileChangeEvent;
+
+	FOnTilesChangedEvent OnTilesChangedEvent;
+
+	FOnGridLoadedEvent OnGridLoadedEvent;
+
+	FOnRegionsChangedEvent OnRegionsChangedEvent;
+
+	// Handles from Blueprint may be default or from another grid, the core only checks them in debug builds
+	bool CheckShape(FGridShapeHandle Shape) const;
+
+	// Area covered by distance fields
+	FIntRect GetFieldBounds() const;
+
+	// Fit every distance field to a new or reloaded grid
+	void ResetDistanceFields();
+
+	// Mirror the loaded size and layout, then tell listeners
+	bool FinishLoad(bool bLoaded);
+};
+
+/**
+ * Opens an edit transaction on the grid for the lifetime of the scope.
+ */
+struct FESGridEditScope
+{
+	explicit FESGridEditScope(UESGridSystem* InGridSystem) : GridSystem(InGridSystem)
+	{
+		GridSystem->BeginEdit();
+	}
+
+	~FESGridEditScope()
+	{
+		GridSystem->CommitEdit();
+	}
+
+	FESGridEditScope(const FESGridEditScope&) = delete;
+
+	FESGridEditScope& operator=(const FESGridEditScope&) = delete;
+
+private:
+	UESGridSystem* GridSystem;
 };
@@ -0,0 +1,277 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+ * Document:#ESGridTerrainGenerator.cpp#
+ * Author: Yuyang Qiu
+ * Function:Seeded procedural ground for the initial grid.
+ */
+
+#include "Core/Grid/ESGridTerrainGenerator.h"
+
+#include "Async/ParallelFor.h"
+#include "Core/Grid/ESGridStorage.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS && (defined(_M_X64) || defined(__x86_64__))
+#define ES_GRID_TERRAIN_SSE 1
+#else
+#define ES_GRID_TERRAIN_SSE 0
+#endif
+
+#if ES_GRID_TERRAIN_SSE
+#include <immintrin.h>
+#endif
+
+// Octaves use unrelated lattices
+static constexpr uint32 OctaveSeedStep = 0x9E3779B9u;
+
+static FORCEINLINE uint32 HashLattice(int32 X, int32 Y, uint32 Seed)
+{
+	uint32 Hash = (static_cast<uint32>(X) * 0x27d4eb2du) ^ (static_cast<uint32>(Y) * 0x165667b1u ^ Seed);
+	Hash ^= Hash >> 15;
+	Hash *= 0x2c1b3c6du;
+	Hash ^= Hash >> 12;
+	Hash *= 0x297a2d39u;
+	Hash ^= Hash >> 15;
+	return Hash;
+}
+
+// Top 24 bits as a float in [0, 1)
+static FORCEINLINE float LatticeValue(uint32 Hash)
+{
+	return static_cast<float>(Hash >> 8) * (1.f / 16777216.f);
+}
+
+static FORCEINLINE float SmoothStep(float T)
+{
+	return T * T * (3.f - 2.f * T);
+}
+
+// Positions are never negative, so truncation is the floor
+static float ValueNoise(float X, float Y, uint32 Seed)
+{
+	const int32 CellX = static_cast<int32>(X);
+	const int32 CellY = static_cast<int32>(Y);
+	const float SX = SmoothStep(X - static_cast<float>(CellX));
+	const float SY = SmoothStep(Y - static_cast<float>(CellY));
+
+	const float V00 = LatticeValue(HashLattice(CellX, CellY, Seed));
+	const float V10 = LatticeValue(HashLattice(CellX + 1, CellY, Seed));
+	const float V01 = LatticeValue(HashLattice(CellX, CellY + 1, Seed));
+	const float V11 = LatticeValue(HashLattice(CellX + 1, CellY + 1, Seed));
+	const float Top = V00 + (V10 - V00) * SX;
+	const float Bottom = V01 + (V11 - V01) * SX;
+	return Top + (Bottom - Top) * SY;
+}
+
+#if ES_GRID_TERRAIN_SSE
+// SSE2 has no 32-bit low multiply, build it from two 32x32->64 multiplies
+static FORCEINLINE __m128i MultiplyLow(__m128i A, __m128i B)
+{
+	const __m128i Even = _mm_mul_epu32(A, B);
+	const __m128i Odd = _mm_mul_epu32(_mm_srli_epi64(A, 32), _mm_srli_epi64(B, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(Even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(Odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Same hash as HashLattice for four X at once
+static FORCEINLINE __m128 LatticeValue4(__m128i X, int32 Y, uint32 Seed)
+{
+	__m128i Hash = _mm_xor_si128(MultiplyLow(X, _mm_set1_epi32(0x27d4eb2d)),
+	                             _mm_set1_epi32(static_cast<int32>(static_cast<uint32>(Y) * 0x165667b1u ^ Seed)));
+	Hash = _mm_xor_si128(Hash, _mm_srli_epi32(Hash, 15));
+	Hash = MultiplyLow(Hash, _mm_set1_epi32(0x2c1b3c6d));
+	Hash = _mm_xor_si128(Hash, _mm_srli_epi32(Hash, 12));
+	Hash = MultiplyLow(Hash, _mm_set1_epi32(0x297a2d39));
+	Hash = _mm_xor_si128(Hash, _mm_srli_epi32(Hash, 15));
+	return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(Hash, 8)), _mm_set1_ps(1.f / 16777216.f));
+}
+
+// ValueNoise at four consecutive X sharing one Y
+static FORCEINLINE __m128 ValueNoise4(__m128 X, float Y, uint32 Seed)
+{
+	const __m128i CellX = _mm_cvttps_epi32(X);
+	const __m128 TX = _mm_sub_ps(X, _mm_cvtepi32_ps(CellX));
+	const __m128 SX = _mm_mul_ps(_mm_mul_ps(TX, TX), _mm_sub_ps(_mm_set1_ps(3.f), _mm_mul_ps(_mm_set1_ps(2.f), TX)));
+	const int32 CellY = static_cast<int32>(Y);
+	const __m128 SY = _mm_set1_ps(SmoothStep(Y - static_cast<float>(CellY)));
+
+	const __m128i NextX = _mm_add_epi32(CellX, _mm_set1_epi32(1));
+	const __m128 V00 = LatticeValue4(CellX, CellY, Seed);
+	const __m128 V10 = LatticeValue4(NextX, CellY, Seed);
+	const __m128 V01 = LatticeValue4(CellX, CellY + 1, Seed);
+	const __m128 V11 = LatticeValue4(NextX, CellY + 1, Seed);
+	const __m128 Top = _mm_add_ps(V00, _mm_mul_ps(_mm_sub_ps(V10, V00), SX));
+	const __m128 Bottom = _mm_add_ps(V01, _mm_mul_ps(_mm_sub_ps(V11, V01), SX));
+	return _mm_add_ps(Top, _mm_mul_ps(_mm_sub_ps(Bottom, Top), SY));
+}
+#endif
+
+void FESGridTerrainGenerator::Generate(const FGridTerrainSettings& Settings, const FIntRect& Area,
+                                       TArray<EGroundType>& OutCells)
+{
+	const int32 Width = Area.Width();
+	const int32 Height = Area.Height();
+	OutCells.Reset();
+	if (Width <= 0 || Height <= 0)
+	{
+		return;
+	}
+	OutCells.SetNumUninitialized(Width * Height);
+
+	// One job per chunk row of cells
+	constexpr int32 RowsPerJob = FESGridStorage::ChunkSize;
+	const int32 NumJobs = FMath::DivideAndRoundUp(Height, RowsPerJob);
+	ParallelFor(NumJobs, [&Settings, &Area, &OutCells, Width, Height](int32 Job)
+	{
+		TArray<float> Heights;
+		Heights.SetNumUninitialized(Width);
+		const int32 End = FMath::Min((Job + 1) * RowsPerJob, Height);
+		for (int32 Row = Job * RowsPerJob; Row < End; ++Row)
+		{
+			GenerateRow(Settings, Area, Area.Min.Y + Row, Heights.GetData(), OutCells.GetData() + Row * Width);
+		}
+	});
+
+	if (Settings.bSingleIsland)
+	{
+		KeepLargestIsland(Area, OutCells);
+	}
+}
+
+float FESGridTerrainGenerator::SampleNoise(const FGridTerrainSettings& Settings, int32 X, int32 Y)
+{
+	float Sum = 0.f;
+	float Total = 0.f;
+	float Amplitude = 1.f;
+	float Frequency = Settings.Frequency;
+	uint32 Seed = static_cast<uint32>(Settings.Seed);
+	for (int32 Octave = 0; Octave < FMath::Max(Settings.Octaves, 1); ++Octave)
+	{
+		Sum += ValueNoise(static_cast<float>(X) * Frequency, static_cast<float>(Y) * Frequency, Seed) * Amplitude;
+		Total += Amplitude;
+		Amplitude *= 0.5f;
+		Frequency *= 2.f;
+		Seed += OctaveSeedStep;
+	}
+	return Sum / Total;
+}
+
+void FESGridTerrainGenerator::GenerateRow(const FGridTerrainSettings& Settings, const FIntRect& Area, int32 Y,
+                                          float* Heights, EGroundType* OutRow)
+{
+	const int32 Width = Area.Width();
+	int32 Column = 0;
+
+#if ES_GRID_TERRAIN_SSE
+	// Four cells per step, the tail goes through SampleNoise
+	const __m128 Lanes = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+	for (; Column + 4 <= Width; Column += 4)
+	{
+		const __m128 X = _mm_add_ps(_mm_set1_ps(static_cast<float>(Area.Min.X + Column)), Lanes);
+		__m128 Sum = _mm_setzero_ps();
+		float Total = 0.f;
+		float Amplitude = 1.f;
+		float Frequency = Settings.Frequency;
+		uint32 Seed = static_cast<uint32>(Settings.Seed);
+		for (int32 Octave = 0; Octave < FMath::Max(Settings.Octaves, 1); ++Octave)
+		{
+			const __m128 Noise = ValueNoise4(_mm_mul_ps(X, _mm_set1_ps(Frequency)), static_cast<float>(Y) * Frequency, Seed);
+			Sum = _mm_add_ps(Sum, _mm_mul_ps(Noise, _mm_set1_ps(Amplitude)));
+			Total += Amplitude;
+			Amplitude *= 0.5f;
+			Frequency *= 2.f;
+			Seed += OctaveSeedStep;
+		}
+		_mm_storeu_ps(Heights + Column, _mm_div_ps(Sum, _mm_set1_ps(Total)));
+	}
+#endif
+
+	for (; Column < Width; ++Column)
+	{
+		Heights[Column] = SampleNoise(Settings, Area.Min.X + Column, Y);
+	}
+
+	const FVector2D Centre(Area.Min.X + Area.Width() * 0.5f, Area.Min.Y + Area.Height() * 0.5f);
+	const FVector2D Radius(FMath::Max(Area.Width() * 0.5f * Settings.IslandRadius, 1.f),
+	                       FMath::Max(Area.Height() * 0.5f * Settings.IslandRadius, 1.f));
+	const float DY = (Y + 0.5f - Centre.Y) / Radius.Y;
+	const EGroundType DefaultType = static_cast<EGroundType>(1);
+	for (Column = 0; Column < Width; ++Column)
+	{
+		const float DX = (Area.Min.X + Column + 0.5f - Centre.X) / Radius.X;
+		const float Height = Heights[Column] - Settings.IslandFalloff * (DX * DX + DY * DY);
+
+		EGroundType Type = EGroundType::None;
+		if (Height >= Settings.GroundLevel)
+		{
+			Type = Settings.Bands.Num() > 0 ? Settings.Bands.Last().Type : DefaultType;
+			for (const FGridTerrainBand& Band : Settings.Bands)
+			{
+				if (Height <= Band.MaxHeight)
+				{
+					Type = Band.Type;
+					break;
+				}
+			}
+		}
+		OutRow[Column] = Type;
+	}
+}
+
+void FESGridTerrainGenerator::KeepLargestIsland(const FIntRect& Area, TArray<EGroundType>& Cells)
+{
+	const int32 Width = Area.Width();
+	const int32 Height = Area.Height();
+
+	// Island of every cell, found in scan order so ties always keep the same island
+	TArray<int32> Islands;
+	Islands.Init(INDEX_NONE, Cells.Num());
+	TArray<int32> Stack;
+	int32 Largest = INDEX_NONE;
+	int32 LargestSize = 0;
+	int32 NumIslands = 0;
+	for (int32 Start = 0; Start < Cells.Num(); ++Start)
+	{
+		if (Cells[Start] == EGroundType::None || Islands[Start] != INDEX_NONE)
+		{
+			continue;
+		}
+
+		const int32 Island = NumIslands++;
+		int32 Size = 0;
+		Islands[Start] = Island;
+		Stack.Add(Start);
+		while (Stack.Num() > 0)
+		{
+			const int32 Cell = Stack.Pop(false);
+			++Size;
+			const int32 X = Cell % Width;
+			const int32 Y = Cell / Width;
+			const int32 Neighbours[4] = {
+				X > 0 ? Cell - 1 : INDEX_NONE, X + 1 < Width ? Cell + 1 : INDEX_NONE,
+				Y > 0 ? Cell - Width : INDEX_NONE, Y + 1 < Height ? Cell + Width : INDEX_NONE
+			};
+			for (const int32 Next : Neighbours)
+			{
+				if (Next != INDEX_NONE && Cells[Next] != EGroundType::None && Islands[Next] == INDEX_NONE)
+				{
+					Islands[Next] = Island;
+					Stack.Add(Next);
+				}
+			}
+		}
+
+		if (Size > LargestSize)
+		{
+			Largest = Island;
+			LargestSize = Size;
+		}
+	}
+
+	for (int32 Cell = 0; Cell < Cells.Num(); ++Cell)
+	{
+		if (Islands[Cell] != Largest)
+		{
+			Cells[Cell] = EGroundType::None;
+		}
+	}
+}
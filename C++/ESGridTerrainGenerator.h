@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Core/Types/GroundType.h"
+#include "ESGridTerrainGenerator.generated.h"
+
+USTRUCT(BlueprintType)
+struct FGridTerrainBand
+{
+	GENERATED_BODY()
+
+		UPROPERTY(BlueprintReadWrite, EditAnywhere)
+		EGroundType Type = EGroundType::None;
+
+	// Highest terrain height of the band, bands are checked in order
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+		float MaxHeight = 1.f;
+};
+
+USTRUCT(BlueprintType)
+struct FGridTerrainSettings
+{
+	GENERATED_BODY()
+
+		UPROPERTY(BlueprintReadWrite, EditAnywhere)
+		int32 Seed = 0;
+
+	// Noise lattice cells per grid cell of the first octave
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+		float Frequency = 0.04f;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+		int32 Octaves = 4;
+
+	// Cells lower than this stay empty, heights are in [0, 1] before the island mask
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+		float GroundLevel = 0.45f;
+
+	// Height lost at the island radius, growing with the squared distance. 0 disables the mask
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+		float IslandFalloff = 0.6f;
+
+	// Island radius as a fraction of half the generated area
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+		float IslandRadius = 0.9f;
+
+	// Only keep the largest island, so every cell could have been placed next to existing ground
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+		bool bSingleIsland = true;
+
+	// Ground type by height, the last band takes everything above it. Empty bands use the first ground type
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+		TArray<FGridTerrainBand> Bands;
+};
+
+/**
+ * Seeded terrain for a new grid: fractal value noise shaped by an island mask, split into ground types by height.
+ * Rows are generated in parallel and noise is evaluated four cells at a time.
+ * Every cell only depends on the settings and its position, so the result is the same for any number of workers.
+ */
+class EVEOFTHESTORM_API FESGridTerrainGenerator
+{
+public:
+	// Cells of Area row by row
+	static void Generate(const FGridTerrainSettings& Settings, const FIntRect& Area, TArray<EGroundType>& OutCells);
+
+	// Fractal noise in [0, 1] at one cell, without the island mask
+	static float SampleNoise(const FGridTerrainSettings& Settings, int32 X, int32 Y);
+
+private:
+	static void GenerateRow(const FGridTerrainSettings& Settings, const FIntRect& Area, int32 Y, float* Heights,
+	                        EGroundType* OutRow);
+
+	// Clear every island but the largest one
+	static void KeepLargestIsland(const FIntRect& Area, TArray<EGroundType>& Cells);
+};
@@ -11,15 +11,16 @@
 #include "GameFramework/Actor.h"
 #include "ESGridActor.generated.h"
 
-USTRUCT()
+// Render chunk coordinate and ground type of one grid mesh component
+USTRUCT(BlueprintType)
 struct FBlockIndex
 {
 	GENERATED_BODY()
 
-		UPROPERTY()
+		UPROPERTY(BlueprintReadOnly)
 		FIntPoint Point;
 
-	UPROPERTY()
+	UPROPERTY(BlueprintReadOnly)
 		EGroundType Type;
 
 	// Hash function required for TMap
@@ -34,6 +35,51 @@ struct FBlockIndex
 	}
 };
 
+/**
+ * Two-way map between grid cells and the instances of one instanced mesh.
+ * Instance i always renders Cells[i], removal moves the last instance into the hole.
+ */
+struct FGridInstanceSet
+{
+	TArray<FIntPoint> Cells;
+
+	TMap<FIntPoint, int32> Instances;
+};
+
+// Pending render change of one cell, RenderedType is what its instance currently shows
+struct FGridRenderOp
+{
+	EGroundType RenderedType = EGroundType::None;
+
+	EGroundType TargetType = EGroundType::None;
+};
+
+// Result of picking the grid with a world-space ray
+USTRUCT(BlueprintType)
+struct FGridPickResult
+{
+	GENERATED_BODY()
+
+		// The ray crossed the ground plane inside the grid
+		UPROPERTY(BlueprintReadOnly)
+		bool bHitGround = false;
+
+	// Cell under the ground plane hit, also set when it is outside the grid
+	UPROPERTY(BlueprintReadOnly)
+		FIntPoint Cell = FIntPoint::ZeroValue;
+
+	// World location of the ground plane hit
+	UPROPERTY(BlueprintReadOnly)
+		FVector Location = FVector::ZeroVector;
+
+	// The ray passed through an occupied cell before reaching the ground
+	UPROPERTY(BlueprintReadOnly)
+		bool bHitTile = false;
+
+	UPROPERTY(BlueprintReadOnly)
+		FIntPoint TileCell = FIntPoint::ZeroValue;
+};
+
 USTRUCT(BlueprintType)
 struct FBlockMaterial
 {
@@ -64,8 +110,9 @@ protected:
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 		USceneComponent* GridScene;
 
-	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-		TMap<EGroundType, UInstancedStaticMeshComponent*> GridMeshes;
+	// One hierarchical instanced mesh per render chunk and ground type, created on first use and destroyed once empty
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Transient)
+		TMap<FBlockIndex, class UHierarchicalInstancedStaticMeshComponent*> GridMeshes;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 		UInstancedStaticMeshComponent* TilePreviewMesh;
@@ -82,6 +129,32 @@ protected:
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
 		float GridOffset = 0;
 
+	// Cells per side of a render chunk, an edit only rebuilds the chunks it touches
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, meta = (ClampMin = "1"))
+		int32 RenderChunkSize = 32;
+
+	// Distance where chunk instances start and finish fading out, 0 keeps them always visible
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
+		int32 ChunkCullDistanceStart = 0;
+
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
+		int32 ChunkCullDistanceEnd = 0;
+
+	// Queue grid changes and apply them in Tick, otherwise they are applied inside the grid event
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
+		bool bDeferRenderUpdates = true;
+
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, meta = (ClampMin = "1"))
+		int32 MaxRenderOpsPerFrame = 4096;
+
+	// 0 disables the time budget
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
+		float MaxRenderMillisecondsPerFrame = 2.0f;
+
+	// Height above the ground plane a placed tile blocks picking rays
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
+		float PickTileHeight = 100.0f;
+
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
 		TMap<EGroundType, FBlockMaterial> GroundMaterials;
 
@@ -94,16 +167,30 @@ protected:
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
 		FName MaterialIsErrorParamName = "IsError";
 
-	void OnTilePlaced(int X, int Y, EGroundType Type);
+	void OnTilesChanged(const FGridEditBatch& Batch);
 
-	void OnTileRemoved(int X, int Y, EGroundType Type);
+	// Drop every instance and queued update, then build all chunks from the grid in one pass
+	void RebuildTiles();
 
-	void OnTileUpdate(int X, int Y, EGroundType OldType, EGroundType NewType);
+	// Ground plane extent and the offsets centring the tiles and preview, they follow the grid size
+	void ApplyGridLayout();
+
+	// Add one instance per cell through the bulk instance API
+	void AddTileInstances(const FBlockIndex& Block, const TArray<FIntPoint>& Cells);
+
+	// Remove the instances of the cells with swap-and-pop, render state is dirtied once
+	void RemoveTileInstances(const FBlockIndex& Block, const TArray<FIntPoint>& Cells);
+
+	FIntPoint GetRenderChunk(int X, int Y) const;
+
+	class UHierarchicalInstancedStaticMeshComponent* FindOrCreateChunkMesh(const FBlockIndex& Block);
+
+	void ReleaseChunkMesh(const FBlockIndex& Block);
 
 	// PREVIEW MESH
 
 	UFUNCTION(BlueprintCallable)
-		void SetPreviewMesh(const FGridTile Tile, EGridDirection Direction);
+		void SetPreviewMesh(const FGridTile& Tile, EGridDirection Direction);
 
 	UFUNCTION(BlueprintCallable)
 		void UpdatePreviewMesh(int X, int Y);
@@ -111,6 +198,10 @@ protected:
 	UFUNCTION(BlueprintCallable)
 		void UpdatePreviewMeshByWorldLocation(const FVector Location);
 
+	// Same as UpdatePreviewMeshByWorldLocation without a physics trace, false when the ray misses the grid
+	UFUNCTION(BlueprintCallable)
+		bool UpdatePreviewMeshByRay(const FVector RayOrigin, const FVector RayDirection);
+
 	UFUNCTION(BlueprintCallable)
 		void HidePreviewMesh();
 
@@ -126,9 +217,14 @@ protected:
 	UPROPERTY(BlueprintReadOnly, Transient)
 		UMaterialInstanceDynamic* PreviewMaterial;
 
+	// Index is the instance in the chunk mesh of the cell, OnTileInstanceSpawned also passes the mesh
 	UFUNCTION(BlueprintImplementableEvent)
 		void OnTileSpawned(EGroundType GroundType, int Index);
 
+	UFUNCTION(BlueprintImplementableEvent)
+		void OnTileInstanceSpawned(EGroundType GroundType, class UHierarchicalInstancedStaticMeshComponent* Mesh, int Index,
+		                           FIntPoint Cell);
+
 	UFUNCTION(BlueprintImplementableEvent)
 		void OnTileDestroyed(EGroundType GroundType, int X, int Y);
 
@@ -139,6 +235,35 @@ public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	// Cells whose mesh instances still wait for the render queue
+	UFUNCTION(BlueprintCallable)
+		int32 GetPendingRenderUpdates() const;
+
+	// Apply the whole render queue now, ignoring the frame budget
+	UFUNCTION(BlueprintCallable)
+		void FlushRenderUpdates();
+
+	/**
+	 * Mesh and instance currently rendering a cell, false when the cell has none yet.
+	 * Instances move when other cells of their chunk are removed, so look them up again after edits.
+	 */
+	UFUNCTION(BlueprintCallable)
+		bool FindTileInstance(int X, int Y, class UHierarchicalInstancedStaticMeshComponent*& OutMesh, int& OutIndex) const;
+
+	// PICKING
+
+	/**
+	 * Intersect a world-space ray with the ground plane and return the cell below the hit.
+	 * With bFindTile the cells the ray crosses below PickTileHeight are walked and the first occupied one is returned too.
+	 */
+	UFUNCTION(BlueprintCallable)
+		bool PickGrid(const FVector& RayOrigin, const FVector& RayDirection, bool bFindTile, FGridPickResult& OutResult) const;
+
+	// Pick one result per ray, the grid transform is only computed once
+	UFUNCTION(BlueprintCallable)
+		void PickGridBatch(const TArray<FVector>& RayOrigins, const TArray<FVector>& RayDirections, bool bFindTile,
+		                   TArray<FGridPickResult>& OutResults) const;
+
 protected:
 	UPROPERTY(BlueprintReadOnly)
 		FIntPoint CurrentTilePreviewLocation;
@@ -149,10 +274,50 @@ protected:
 	UPROPERTY(BlueprintReadOnly)
 		FGridTile CurrentTile;
 
+	UPROPERTY(BlueprintReadOnly)
+		FGridShapeHandle CurrentShape;
+
 private:
 
 	// UPROPERTY()
 	// TArray<FIntPoint> MeshIndex;
 
-	TMap<EGroundType, TArray<FIntPoint>> MeshIndex;
+	TMap<FBlockIndex, FGridInstanceSet> MeshIndex;
+
+	// Apply queued cells until MaxOps cells were applied or MaxSeconds passed (0 for no limit)
+	void ProcessRenderOps(int32 MaxOps, double MaxSeconds);
+
+	TMap<FIntPoint, FGridRenderOp> PendingRenderOps;
+
+	// Queue order, cells cancelled or applied early are skipped
+	TArray<FIntPoint> PendingRenderOrder;
+
+	int32 PendingRenderHead = 0;
+
+	// Ground plane height in the grid scene space
+	float GetPickPlaneHeight(const FTransform& GridTransform) const;
+
+	// Ray already in grid scene space
+	bool PickGridLocal(const FTransform& GridTransform, const FVector& Origin, const FVector& Direction, float PlaneZ,
+	                   bool bFindTile, FGridPickResult& OutResult) const;
+
+	// PREVIEW CACHE
+
+	FORCEINLINE static int32 GetPreviewKey(FGridShapeHandle Shape, EGridDirection Direction)
+	{
+		return Shape.Index * GridDirectionCount + static_cast<int32>(Direction);
+	}
+
+	// Instance transforms of every shape and direction previewed so far
+	TMap<int32, TArray<FTransform>> PreviewTransforms;
+
+	// Key of the instances in TilePreviewMesh, INDEX_NONE when it is empty
+	int32 ShownPreviewKey = INDEX_NONE;
+
+	// Cell and grid edit version the preview validity was computed for
+	FIntPoint PreviewCell = FIntPoint(MAX_int32, MAX_int32);
+
+	int32 PreviewEditVersion = INDEX_NONE;
+
+	int32 PreviewErrorValue = INDEX_NONE;
 };